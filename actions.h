@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Action alphabets. ExpertAdvice keeps the weight behind each action in an
+// ActionWeights<A, Actions>. The default, SparseActions, puts it in a
+// std::map keyed on the action. A finite alphabet can instead provide
+// dense traits,
+//
+//     static constexpr size_t size;
+//     static size_t index(const A &a);   // in [0, size)
+//     static A action(size_t i);
+//
+// and the weights are then summed into a flat array with no allocation
+// per round.
+template <typename A> struct SparseActions {};
+
+// Matching pennies: left is -1, right is +1.
+struct BinaryActions {
+    static constexpr size_t size = 2;
+    static size_t index(int a) { return a > 0; }
+    static int action(size_t i) { return i ? 1 : -1; }
+};
+
+// Integer actions 0, 1, ..., N - 1.
+template <size_t N, typename A = int> struct RangeActions {
+    static constexpr size_t size = N;
+    static size_t index(A a) { return (size_t)a; }
+    static A action(size_t i) { return (A)i; }
+};
+
+template <typename A, typename Actions> struct ActionWeights {
+    std::vector<double> mass = std::vector<double>(Actions::size);
+
+    // Adds w[i] to the action of advice[i] for every expert i.
+    void assign(const A *advice, const double *w, size_t n) {
+        std::fill(mass.begin(), mass.end(), 0.0);
+        for (size_t i = 0; i < n; i++) {
+            mass[Actions::index(advice[i])] += w[i];
+        }
+    }
+
+    // Adds w[i] * q[i * size + a] to action a for every expert i, where q
+    // holds each expert's distribution over the actions.
+    void assign_probabilities(const double *q, const double *w, size_t n) {
+        std::fill(mass.begin(), mass.end(), 0.0);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t a = 0; a < Actions::size; a++) {
+                mass[a] += w[i] * q[i * Actions::size + a];
+            }
+        }
+    }
+
+    void add(const ActionWeights &other) {
+        for (size_t a = 0; a < Actions::size; a++) {
+            mass[a] += other.mass[a];
+        }
+    }
+
+    double operator[](const A &a) const {
+        auto i = Actions::index(a);
+        return i < mass.size() ? mass[i] : 0.0;
+    }
+};
+
+template <typename A> struct ActionWeights<A, SparseActions<A>> {
+    std::map<A, double> mass;
+
+    void assign(const A *advice, const double *w, size_t n) {
+        mass.clear();
+        for (size_t i = 0; i < n; i++) {
+            mass[advice[i]] += w[i];
+        }
+    }
+
+    void add(const ActionWeights &other) {
+        for (const auto &kv : other.mass) {
+            mass[kv.first] += kv.second;
+        }
+    }
+
+    double operator[](const A &a) const {
+        auto it = mass.find(a);
+        return it == mass.end() ? 0.0 : it->second;
+    }
+};
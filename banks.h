@@ -0,0 +1,321 @@
+#pragma once
+
+#include "pennies.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+// Structure-of-arrays banks for the built-in expert families. Each bank
+// gives the same advice, from the same uniforms, as the corresponding list
+// of individual experts in pennies.h, but keeps its parameters and state in
+// contiguous arrays so that every member is computed in one loop.
+
+// Sets out[i] = -1 if u[i] <= q[i] and 1 otherwise.
+inline void threshold_advice(const double *u, const double *q, int *out,
+                             size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = u[i] <= q[i] ? -1 : 1;
+    }
+}
+
+inline void threshold_advice(const double *u, double q, int *out,
+                             size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = u[i] <= q ? -1 : 1;
+    }
+}
+
+// The distributions of the same advice, actions apart in out.
+inline void threshold_probabilities(const double *q, double *out,
+                                    size_t actions, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        binary_probabilities(q[i], out + i * actions);
+    }
+}
+
+inline void threshold_probabilities(double q, double *out, size_t actions,
+                                    size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        binary_probabilities(q, out + i * actions);
+    }
+}
+
+struct ProportionBank {
+    std::vector<double> p;
+    ProportionBank(std::vector<double> p) : p{p} {}
+
+    size_t size() const { return p.size(); }
+    void reset() {}
+    void observe(int /*prediction*/, int /*outcome*/) {}
+
+    void advise(const double *u, int *out) {
+        threshold_advice(u, p.data(), out, size());
+    }
+
+    void probabilities(double *q, size_t actions) {
+        threshold_probabilities(p.data(), q, actions, size());
+    }
+};
+
+// Correlated and streak experts both return a shared sign s with
+// probability p and -s otherwise.
+struct SignBank {
+    std::vector<double> p;
+    int last;
+    SignBank(std::vector<double> p) : p{p}, last{0} {}
+
+    size_t size() const { return p.size(); }
+    void reset() { last = 0; }
+    auto state() { return std::tie(last); }
+
+    void advise(const double *u, int *out) {
+        if (last == 0) {
+            threshold_advice(u, 0.5, out, size());
+            return;
+        }
+        for (size_t i = 0; i < size(); i++) {
+            out[i] = u[i] <= p[i] ? last : -last;
+        }
+    }
+
+    void probabilities(double *q, size_t actions) {
+        if (last == 0) {
+            threshold_probabilities(0.5, q, actions, size());
+            return;
+        }
+        for (size_t i = 0; i < size(); i++) {
+            binary_probabilities(last < 0 ? p[i] : 1 - p[i], q + i * actions);
+        }
+    }
+};
+
+struct CorrelatedBank : SignBank {
+    using SignBank::SignBank;
+    void observe(int /*prediction*/, int outcome) { last = outcome; }
+};
+
+struct StreakBank : SignBank {
+    using SignBank::SignBank;
+    void observe(int prediction, int outcome) { last = outcome * prediction; }
+};
+
+struct ExponentialBank {
+    std::vector<double> beta;
+    std::vector<double> accum, weight;
+    std::vector<double> q;
+    int count;
+    ExponentialBank(std::vector<double> beta)
+        : beta{beta}, accum(beta.size()), weight(beta.size()),
+          q(beta.size()), count{0} {}
+
+    size_t size() const { return beta.size(); }
+
+    void reset() {
+        std::fill(accum.begin(), accum.end(), 0.0);
+        std::fill(weight.begin(), weight.end(), 0.0);
+        count = 0;
+    }
+
+    auto state() { return std::tie(accum, weight, count); }
+
+    void observe(int /*prediction*/, int outcome) {
+        for (size_t i = 0; i < size(); i++) {
+            accum[i] = accum[i] * beta[i] + outcome;
+            weight[i] = weight[i] * beta[i] + 1;
+        }
+        count++;
+    }
+
+    void advise(const double *u, int *out) {
+        if (count == 0) {
+            threshold_advice(u, 0.5, out, size());
+            return;
+        }
+        update_q();
+        threshold_advice(u, q.data(), out, size());
+    }
+
+    void probabilities(double *out, size_t actions) {
+        if (count == 0) {
+            threshold_probabilities(0.5, out, actions, size());
+            return;
+        }
+        update_q();
+        threshold_probabilities(q.data(), out, actions, size());
+    }
+
+  private:
+    void update_q() {
+        for (size_t i = 0; i < size(); i++) {
+            q[i] = (accum[i] / weight[i] + 1) / 2.0;
+        }
+    }
+};
+
+// Members are (omega[i], phi[i]) pairs. Members with the same frequency
+// share its running sums: with c = cos(omega t) and s = sin(omega t),
+//
+//     sum y_t cos(omega t + phi) = cos(phi) sum y_t c - sin(phi) sum y_t s
+//
+// and likewise for the sum of the cosines themselves, so a round costs
+// O(frequencies) and no trigonometry. e^(i omega t) is advanced by one
+// complex multiplication and recomputed exactly every 64 rounds, so that
+// rounding cannot build up. Members with a period of 0 have no frequency
+// and advise 1, as CosineExpert does.
+struct CosineBank {
+    static constexpr size_t none = SIZE_MAX;
+
+    std::vector<double> omega, phi;
+    std::vector<double> cos_phi, sin_phi;
+    std::vector<size_t> frequency; // of each member, or none
+
+    // Per frequency: e^(i omega count), e^(i omega), and the sums of
+    // y_t c, y_t s, c and s over the rounds so far.
+    std::vector<double> freq;
+    std::vector<double> re, im, step_re, step_im;
+    std::vector<double> y_cos, y_sin, cos_sum, sin_sum;
+
+    std::vector<double> q;
+    unsigned int count;
+    CosineBank(std::vector<double> omega, std::vector<double> phi)
+        : omega{omega}, phi{phi}, q(omega.size()), count{0} {
+        std::map<double, size_t> index;
+        for (size_t i = 0; i < size(); i++) {
+            cos_phi.push_back(std::cos(phi[i]));
+            sin_phi.push_back(std::sin(phi[i]));
+            double w = reduce_frequency(omega[i]);
+            if (!std::isfinite(w)) {
+                frequency.push_back(none);
+                continue;
+            }
+            auto f = index.emplace(w, freq.size());
+            if (f.second) {
+                freq.push_back(w);
+                step_re.push_back(std::cos(w));
+                step_im.push_back(std::sin(w));
+            }
+            frequency.push_back(f.first->second);
+        }
+        auto n = freq.size();
+        re.resize(n);
+        im.resize(n);
+        y_cos.resize(n);
+        y_sin.resize(n);
+        cos_sum.resize(n);
+        sin_sum.resize(n);
+        reset();
+    }
+
+    size_t size() const { return omega.size(); }
+
+    void reset() {
+        std::fill(y_cos.begin(), y_cos.end(), 0.0);
+        std::fill(y_sin.begin(), y_sin.end(), 0.0);
+        std::fill(cos_sum.begin(), cos_sum.end(), 0.0);
+        std::fill(sin_sum.begin(), sin_sum.end(), 0.0);
+        count = 0;
+        anchor();
+    }
+
+    auto state() {
+        return std::tie(re, im, y_cos, y_sin, cos_sum, sin_sum, count);
+    }
+
+    void observe(int /*prediction*/, int outcome) {
+        for (size_t f = 0; f < freq.size(); f++) {
+            y_cos[f] += outcome * re[f];
+            y_sin[f] += outcome * im[f];
+            cos_sum[f] += re[f];
+            sin_sum[f] += im[f];
+        }
+        count++;
+        if (count % 64 == 0) {
+            anchor();
+            return;
+        }
+        for (size_t f = 0; f < freq.size(); f++) {
+            double r = re[f] * step_re[f] - im[f] * step_im[f];
+            im[f] = re[f] * step_im[f] + im[f] * step_re[f];
+            re[f] = r;
+        }
+    }
+
+    void advise(const double *u, int *out) {
+        if (count == 0) {
+            threshold_advice(u, 0.5, out, size());
+            return;
+        }
+        update_q();
+        threshold_advice(u, q.data(), out, size());
+    }
+
+    void probabilities(double *out, size_t actions) {
+        if (count == 0) {
+            threshold_probabilities(0.5, out, actions, size());
+            return;
+        }
+        update_q();
+        threshold_probabilities(q.data(), out, actions, size());
+    }
+
+  private:
+    void anchor() {
+        for (size_t f = 0; f < freq.size(); f++) {
+            re[f] = std::cos(freq[f] * count);
+            im[f] = std::sin(freq[f] * count);
+        }
+    }
+
+    void update_q() {
+        for (size_t i = 0; i < size(); i++) {
+            auto f = frequency[i];
+            if (f == none) {
+                q[i] = 0.0;
+                continue;
+            }
+            double accum = cos_phi[i] * y_cos[f] - sin_phi[i] * y_sin[f];
+            double total = cos_phi[i] * cos_sum[f] - sin_phi[i] * sin_sum[f];
+            q[i] = cosine_probability(accum, total);
+        }
+    }
+};
+
+// The probability of -1 for every member and every context of the last two
+// outcomes is one table; advice is a single column of it.
+struct LengthTwoBank {
+    // Columns: no context yet, then (-1,-1), (-1,1), (1,-1), (1,1).
+    std::vector<double> table[5];
+    int x, y;
+    LengthTwoBank(std::vector<double> a, std::vector<double> b,
+                  std::vector<double> c, std::vector<double> d)
+        : table{std::vector<double>(a.size(), 0.5), a, b, c, d}, x{0},
+          y{0} {}
+
+    size_t size() const { return table[0].size(); }
+
+    void reset() {
+        x = 0;
+        y = 0;
+    }
+
+    auto state() { return std::tie(x, y); }
+
+    void observe(int /*prediction*/, int outcome) {
+        x = y;
+        y = outcome;
+    }
+
+    void advise(const double *u, int *out) {
+        threshold_advice(u, table[column()].data(), out, size());
+    }
+
+    void probabilities(double *q, size_t actions) {
+        threshold_probabilities(table[column()].data(), q, actions, size());
+    }
+
+  private:
+    int column() const { return x == 0 ? 0 : 1 + (x == 1) * 2 + (y == 1); }
+};
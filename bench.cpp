@@ -0,0 +1,435 @@
+#include "banks.h"
+#include "ctw.h"
+#include "lib/fmt/include/fmt/format.h"
+#include "pattern.h"
+#include "pennies.h"
+#include "pool.h"
+#include "rng.h"
+#include "sampler.h"
+#include "snapshot.h"
+#include "suffix.h"
+#include "util.h"
+#include "weights.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Microbenchmarks for the learner hot path. Every kernel is timed in
+// batches long enough to hide the clock overhead; each batch gives one
+// sample of the time per call, and the samples are summarized as
+// percentiles.
+
+struct BenchOptions {
+    std::vector<size_t> experts = {10, 100, 1000, 10000, 100000, 1000000};
+    std::vector<size_t> history = {1, 100, 10000};
+    int samples = 200;
+    double budget = 0.5;     // seconds per kernel and configuration
+    double max_work = 2e8;   // skip warmups longer than experts * history
+    std::string format = "table";
+    std::string filter;
+    uint64_t seed = 1;
+    int threads = 4; // for ExpertAdvice::update/threads
+};
+
+struct Result {
+    std::string kernel;
+    size_t experts;
+    size_t history;
+    std::vector<double> ns;
+
+    double percentile(double p) const {
+        auto idx = (size_t)(p * (ns.size() - 1) + 0.5);
+        return ns[idx];
+    }
+
+    double mean() const {
+        double s = 0.0;
+        for (auto x : ns) {
+            s += x;
+        }
+        return s / ns.size();
+    }
+};
+
+static double now_ns() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(
+               steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static std::vector<double> measure(const std::function<void()> &f,
+                                   const BenchOptions &opts) {
+    double t0 = now_ns();
+    f();
+    double single = std::max(1.0, now_ns() - t0);
+    long batch = std::min(10000L, std::max(1L, (long)(2000.0 / single)));
+
+    std::vector<double> ns;
+    double deadline = now_ns() + opts.budget * 1e9;
+    while ((int)ns.size() < opts.samples &&
+           (ns.size() < 5 || now_ns() < deadline)) {
+        double start = now_ns();
+        for (long i = 0; i < batch; i++) {
+            f();
+        }
+        ns.push_back((now_ns() - start) / batch);
+    }
+    std::sort(ns.begin(), ns.end());
+    return ns;
+}
+
+static std::vector<size_t> parse_list(const std::string &s) {
+    std::vector<size_t> out;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        if (comma == std::string::npos)
+            comma = s.size();
+        out.push_back((size_t)std::stod(s.substr(pos, comma - pos)));
+        pos = comma + 1;
+    }
+    if (out.empty())
+        throw std::invalid_argument("empty list: " + s);
+    return out;
+}
+
+static void usage() {
+    fmt::print(stderr,
+               "usage: mindreader-bench [--experts N,N,...] "
+               "[--history T,T,...]\n"
+               "                        [--samples S] [--budget SECONDS] "
+               "[--max-work W]\n"
+               "                        [--filter SUBSTRING] "
+               "[--format table|csv|json] [--seed S]\n"
+               "                        [--threads T]\n");
+}
+
+static BenchOptions parse_options(int argc, char **argv) {
+    BenchOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--experts")
+            opts.experts = parse_list(value);
+        else if (arg == "--history")
+            opts.history = parse_list(value);
+        else if (arg == "--samples")
+            opts.samples = std::stoi(value);
+        else if (arg == "--budget")
+            opts.budget = std::stod(value);
+        else if (arg == "--max-work")
+            opts.max_work = std::stod(value);
+        else if (arg == "--filter")
+            opts.filter = value;
+        else if (arg == "--format")
+            opts.format = value;
+        else if (arg == "--seed")
+            opts.seed = std::stoull(value);
+        else if (arg == "--threads")
+            opts.threads = std::stoi(value);
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+    if (opts.format != "table" && opts.format != "csv" &&
+        opts.format != "json")
+        throw std::invalid_argument("unknown format " + opts.format);
+    if (opts.samples < 5)
+        opts.samples = 5;
+    if (opts.threads < 1)
+        opts.threads = 1;
+    return opts;
+}
+
+struct Bench {
+    BenchOptions opts;
+    std::vector<Result> results;
+
+    bool wanted(const std::string &kernel) const {
+        return opts.filter.empty() ||
+               kernel.find(opts.filter) != std::string::npos;
+    }
+
+    void run(const std::string &kernel, size_t experts, size_t history,
+             const std::function<void()> &f) {
+        if (!wanted(kernel))
+            return;
+        results.push_back({kernel, experts, history, measure(f, opts)});
+        if (opts.format == "table")
+            print_row(results.back());
+    }
+
+    static void print_header() {
+        fmt::print("{:<32} {:>8} {:>8} {:>12} {:>12} {:>12} {:>12}\n",
+                   "kernel", "experts", "history", "p50 ns", "p90 ns",
+                   "p99 ns", "mean ns");
+    }
+
+    static void print_row(const Result &r) {
+        fmt::print("{:<32} {:>8} {:>8} {:>12.1f} {:>12.1f} {:>12.1f} "
+                   "{:>12.1f}\n",
+                   r.kernel, r.experts, r.history, r.percentile(0.5),
+                   r.percentile(0.9), r.percentile(0.99), r.mean());
+        std::fflush(stdout);
+    }
+
+    void print_csv() const {
+        fmt::print("kernel,experts,history,samples,min_ns,p50_ns,p90_ns,"
+                   "p99_ns,mean_ns\n");
+        for (const auto &r : results) {
+            fmt::print("{},{},{},{},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f}\n",
+                       r.kernel, r.experts, r.history, r.ns.size(),
+                       r.ns.front(), r.percentile(0.5), r.percentile(0.9),
+                       r.percentile(0.99), r.mean());
+        }
+    }
+
+    void print_json() const {
+        fmt::print("{{\"weights_kernel\": \"{}\", \"results\": [\n",
+                   weights_kernel_name());
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &r = results[i];
+            fmt::print("  {{\"kernel\": \"{}\", \"experts\": {}, "
+                       "\"history\": {}, \"samples\": {}, "
+                       "\"min_ns\": {:.2f}, \"p50_ns\": {:.2f}, "
+                       "\"p90_ns\": {:.2f}, \"p99_ns\": {:.2f}, "
+                       "\"mean_ns\": {:.2f}}}{}\n",
+                       r.kernel, r.experts, r.history, r.ns.size(),
+                       r.ns.front(), r.percentile(0.5), r.percentile(0.9),
+                       r.percentile(0.99), r.mean(),
+                       i + 1 < results.size() ? "," : "");
+        }
+        fmt::print("]}}\n");
+    }
+
+    // Kernels that depend on the size of the pool and the game so far.
+    void learner(size_t n, size_t t) {
+        auto pool = random_pool(n, opts.seed);
+        int nrounds = (int)std::max<size_t>(101, t);
+        auto E = ExpertAdvice<int, int, BinaryActions>(
+            zero_one_loss, nrounds, pool.banks, pool.labels);
+        E.seed(opts.seed);
+        RandomStream moves(opts.seed, 1);
+        auto move = [&moves] { return moves() <= 0.5 ? -1 : 1; };
+
+        for (size_t i = 0; i < t; i++) {
+            E.update(E.predict(), move());
+        }
+
+        run("ExpertAdvice::update", n, t,
+            [&] { E.update(E.predict(), move()); });
+        run("ExpertAdvice::predict", n, t, [&] { E.predict(); });
+        run("ExpertAdvice::update_debug", n, t, [&] { E.update_debug(); });
+
+        auto S = ExpertAdvice<int, int, BinaryActions>(zero_one_loss, 0,
+                                                       pool.banks,
+                                                       pool.labels);
+        S.seed(opts.seed);
+        for (size_t i = 0; i < t; i++) {
+            S.update(S.predict(), move());
+        }
+        run("ExpertAdvice::update/streaming", n, t,
+            [&] { S.update(S.predict(), move()); });
+
+        auto B = ExpertAdvice<int, int, BinaryActions>(
+            zero_one_loss, nrounds,
+            PoolSpec::random(n, opts.seed).static_banks(), pool.labels);
+        B.seed(opts.seed);
+        for (size_t i = 0; i < t; i++) {
+            B.update(B.predict(), move());
+        }
+        run("ExpertAdvice::update/static", n, t,
+            [&] { B.update(B.predict(), move()); });
+
+        auto P = ExpertAdvice<int, int, BinaryActions>(
+            zero_one_loss, nrounds, pool.banks, pool.labels);
+        P.set_threads(opts.threads);
+        P.seed(opts.seed);
+        for (size_t i = 0; i < t; i++) {
+            P.update(P.predict(), move());
+        }
+        run("ExpertAdvice::update/threads", n, t,
+            [&] { P.update(P.predict(), move()); });
+
+        auto X = ExpertAdvice<int, int, BinaryActions>(
+            zero_one_loss, nrounds, pool.banks, pool.labels,
+            LossMode::expected);
+        X.seed(opts.seed);
+        for (size_t i = 0; i < t; i++) {
+            X.update(X.predict(), move());
+        }
+        run("ExpertAdvice::update/expected", n, t,
+            [&] { X.update(X.predict(), move()); });
+
+        // Saved here as well, so that load runs without save.
+        SnapshotWriter snapshot;
+        E.save(snapshot);
+        run("ExpertAdvice::save", n, t, [&] {
+            snapshot.bytes.clear();
+            E.save(snapshot);
+        });
+        run("ExpertAdvice::load", n, t, [&] {
+            SnapshotReader r(snapshot.bytes.data(), snapshot.bytes.size());
+            E.load(r);
+        });
+
+        auto scores = E.scores;
+        auto weights = E.pct_weights();
+        if (weights.size() != n)
+            throw std::logic_error("bench: missing weights");
+        std::vector<double> buffer(n);
+        volatile unsigned sink = 0;
+
+        run("softmax_sample", n, t,
+            [&] { sink = softmax_sample(scores, E.eta); });
+        run("sample", n, t, [&] { sink = sample(weights); });
+        run("softmax_weights", n, t, [&] {
+            softmax_weights(scores.data(), n, E.eta, buffer.data());
+        });
+
+        FenwickSampler sampler;
+        sampler.assign(weights.data(), n);
+        run("FenwickSampler::find", n, t,
+            [&] { sink = sampler.find(moves() * sampler.total()); });
+        run("FenwickSampler::set", n, t, [&] {
+            auto i = (size_t)(moves() * n);
+            sampler.set(i, weights[i]);
+        });
+
+        run("BitHistory::context", n, t,
+            [&] { sink = (unsigned)E.outcomes.context(16); });
+        run("BitHistory::count", n, t,
+            [&] { sink = (unsigned)E.outcomes.count(); });
+        run("BitHistory::streak", n, t,
+            [&] { sink = (unsigned)E.outcomes.streak(); });
+
+        TournamentTree tree;
+        std::vector<size_t> top;
+        tree.assign(scores.data(), n);
+        run("TournamentTree::top50", n, t, [&] { tree.top(50, top); });
+        run("TournamentTree::set", n, t, [&] {
+            auto i = (size_t)(moves() * n);
+            tree.set(i, scores[i]);
+        });
+        // A ranking read on its own, and read once per round; the cost of
+        // keeping it up to date is the difference from ExpertAdvice::update.
+        run("ExpertAdvice::ranking50", n, t, [&] { E.ranking(50); });
+        run("ExpertAdvice::update+ranking50", n, t, [&] {
+            E.update(E.predict(), move());
+            E.ranking(50);
+        });
+    }
+
+    // One bank of n members per family: observe and advise for a round.
+    template <typename B>
+    void bank(const std::string &name, size_t n, B b) {
+        std::vector<double> u(n);
+        std::vector<int> out(n);
+        RandomStream rng(opts.seed);
+        rng.fill(u.data(), n);
+        run(name + "::round", n, 0, [&] {
+            b.observe(1, -1);
+            b.advise(u.data(), out.data());
+        });
+    }
+
+    void banks(size_t n) {
+        std::vector<double> p(n, 0.7), q(n, 0.3);
+        bank("ProportionBank", n, ProportionBank(p));
+        bank("ExponentialBank", n, ExponentialBank(p));
+        bank("StreakBank", n, StreakBank(p));
+        bank("CorrelatedBank", n, CorrelatedBank(p));
+        bank("CosineBank", n, CosineBank(p, q));
+
+        // Five phases per frequency, as in the default pool, and one
+        // frequency per member.
+        std::vector<double> omega(n), phi(n), distinct(n);
+        for (size_t i = 0; i < n; i++) {
+            omega[i] = 0.1 + (double)(i / 5);
+            phi[i] = (double)(i % 5);
+            distinct[i] = 0.1 + (double)i;
+        }
+        bank("CosineBank/grid", n, CosineBank(omega, phi));
+        bank("CosineBank/distinct", n, CosineBank(distinct, phi));
+        bank("LengthTwoBank", n, LengthTwoBank(p, q, p, q));
+        bank("ContextTreeBank", n, ContextTreeBank(std::vector<int>(n, 8)));
+        bank("SuffixMatchBank", n, SuffixMatchBank(p));
+        bank("WindowBank", n, WindowBank(std::vector<int>(n, 16)));
+        bank("RunBank", n, RunBank(std::vector<int>(n, 3)));
+    }
+
+    // A single expert's operator(), for each family.
+    template <typename E> void expert(const std::string &name, E e) {
+        RandomStream rng(opts.seed);
+        volatile int sink = 0;
+        e.observe(1, -1);
+        e.observe(-1, 1);
+        run(name + "::operator()", 1, 0, [&] { sink = e(rng()); });
+    }
+
+    void experts() {
+        expert("ProportionExpert", ProportionExpert(0.7));
+        expert("ExponentialExpert", ExponentialExpert(0.7));
+        expert("StreakExpert", StreakExpert(0.7));
+        expert("CorrelatedExpert", CorrelatedExpert(0.7));
+        expert("CosineExpert", CosineExpert(0.7, 0.3));
+        expert("LengthTwoExpert", LengthTwoExpert(0.1, 0.3, 0.5, 0.7));
+        expert("ContextTreeExpert", ContextTreeExpert(8));
+        expert("SuffixMatchExpert", SuffixMatchExpert(0.7));
+        expert("WindowExpert", WindowExpert(16));
+        expert("RunExpert", RunExpert(3));
+    }
+};
+
+int main(int argc, char **argv) {
+    Bench bench;
+    try {
+        bench.opts = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-bench: {}\n", e.what());
+        usage();
+        return 1;
+    }
+    const auto &opts = bench.opts;
+
+    if (opts.format == "table") {
+        fmt::print("weights kernel: {}\n", weights_kernel_name());
+        Bench::print_header();
+    }
+
+    bench.experts();
+    for (auto n : opts.experts) {
+        bench.banks(n);
+    }
+    for (auto n : opts.experts) {
+        for (auto t : opts.history) {
+            if ((double)n * t > opts.max_work) {
+                if (opts.format == "table")
+                    fmt::print("skipping {} experts x {} rounds "
+                               "(over --max-work)\n",
+                               n, t);
+                continue;
+            }
+            bench.learner(n, t);
+        }
+    }
+
+    if (opts.format == "csv")
+        bench.print_csv();
+    else if (opts.format == "json")
+        bench.print_json();
+
+    return 0;
+}
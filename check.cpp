@@ -0,0 +1,386 @@
+#include "lib/fmt/include/fmt/format.h"
+#include "history.h"
+#include "opponent.h"
+#include "pennies.h"
+#include "pool.h"
+#include "reference.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "util.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Differential checker: plays randomized games with ReferenceAdvice and
+// every optimized learner on the same seeded streams, feeds them the same
+// moves, and checks that advice, scores, weights, ranking, per-action mass
+// and predictions agree round by round. Most games use a random pool; every
+// eighth uses the GUI pool.
+
+struct CheckOptions {
+    long games = 2000;
+    size_t max_experts = 600;
+    int max_rounds = 200;
+    double tolerance = 1e-9;
+    uint64_t seed = 1;
+    std::string filter;
+};
+
+// The state the checker compares, for any learner.
+struct Learner {
+    virtual ~Learner() = default;
+    virtual void seed(uint64_t seed, uint64_t stream) = 0;
+    virtual void reset() = 0;
+    virtual int predict() = 0;
+    virtual void update(int prediction, int outcome) = 0;
+    virtual void update_debug() = 0;
+    virtual const std::vector<int> &advice() const = 0;
+    virtual const std::vector<double> &scores() const = 0;
+    virtual const std::vector<double> &pct_weights() const = 0;
+    virtual const std::vector<size_t> &indices() const = 0;
+    virtual double action_pct_weight(int a) const = 0;
+};
+
+template <typename L> struct LearnerOf : Learner {
+    L l;
+    template <typename... Args> LearnerOf(Args &&... args) : l{args...} {}
+
+    void seed(uint64_t seed, uint64_t stream) override {
+        l.seed(seed, stream);
+    }
+    void reset() override { l.reset(); }
+    int predict() override { return l.predict(); }
+    void update(int p, int y) override { l.update(p, y); }
+    void update_debug() override { l.update_debug(); }
+    const std::vector<int> &advice() const override { return l.advice; }
+    const std::vector<double> &scores() const override { return l.scores; }
+    const std::vector<double> &pct_weights() const override {
+        return l.m_pct_weights;
+    }
+    const std::vector<size_t> &indices() const override {
+        return l.m_indices;
+    }
+    double action_pct_weight(int a) const override {
+        return action_weight(l.m_action_pct_weights, a);
+    }
+
+  private:
+    static double action_weight(const std::map<int, double> &m, int a) {
+        auto it = m.find(a);
+        return it == m.end() ? 0.0 : it->second;
+    }
+    template <typename W> static double action_weight(const W &w, int a) {
+        return w[a];
+    }
+};
+
+// Wipes the learner and restores it from a snapshot after every update.
+template <typename L> struct SnapshotLearnerOf : LearnerOf<L> {
+    using LearnerOf<L>::LearnerOf;
+
+    void update(int p, int y) override {
+        this->l.update(p, y);
+        SnapshotWriter w;
+        this->l.save(w);
+        this->l.reset();
+        SnapshotReader r(w.bytes.data(), w.bytes.size());
+        this->l.load(r);
+    }
+};
+
+using LearnerFactory =
+    std::function<std::unique_ptr<Learner>(const PoolSpec &, int)>;
+
+struct Variant {
+    std::string name;
+    LearnerFactory make;
+    LossMode mode = LossMode::sampled;
+    long rounds = 0;
+    long prediction_mismatches = 0;
+};
+
+static std::vector<Variant> variants() {
+    using Binary = ExpertAdvice<int, int, BinaryActions>;
+    using Sparse = ExpertAdvice<int, int>;
+    return {
+        {"banks",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.banks(), spec.labels());
+         }},
+        {"static-bank",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.static_banks(),
+                 spec.labels());
+         }},
+        {"threads",
+         [](const PoolSpec &spec, int nrounds) {
+             auto learner = std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.banks(7), spec.labels());
+             learner->l.set_threads(3);
+             return learner;
+         }},
+        {"expert-list",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.experts(), spec.labels());
+         }},
+        {"sparse-actions",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<LearnerOf<Sparse>>(
+                 zero_one_loss, nrounds, spec.banks(), spec.labels());
+         }},
+        {"snapshot",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<SnapshotLearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.banks(), spec.labels());
+         }},
+        {"snapshot-list",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<SnapshotLearnerOf<Sparse>>(
+                 zero_one_loss, nrounds, spec.experts(), spec.labels());
+         }},
+        {"expected-banks",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.banks(), spec.labels(),
+                 LossMode::expected);
+         },
+         LossMode::expected},
+        {"expected-static",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<SnapshotLearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.static_banks(),
+                 spec.labels(), LossMode::expected);
+         },
+         LossMode::expected},
+        {"expected-threads",
+         [](const PoolSpec &spec, int nrounds) {
+             auto learner = std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.banks(7), spec.labels(),
+                 LossMode::expected);
+             learner->l.set_threads(3);
+             return learner;
+         },
+         LossMode::expected},
+        {"expected-list",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<LearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.experts(), spec.labels(),
+                 LossMode::expected);
+         },
+         LossMode::expected},
+        {"expected-snapshot",
+         [](const PoolSpec &spec, int nrounds) {
+             return std::make_unique<SnapshotLearnerOf<Binary>>(
+                 zero_one_loss, nrounds, spec.banks(), spec.labels(),
+                 LossMode::expected);
+         },
+         LossMode::expected},
+    };
+}
+
+struct Mismatch : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+static bool close(double a, double b, double tol) {
+    return std::abs(a - b) <= tol * std::max(1.0, std::abs(a));
+}
+
+// Compares everything but the predictions; throws Mismatch on the first
+// difference.
+static void compare(const Learner &ref, const Learner &var, double tol) {
+    auto n = ref.advice().size();
+    if (var.advice().size() != n)
+        throw Mismatch("different number of experts");
+
+    for (size_t i = 0; i < n; i++) {
+        if (ref.advice()[i] != var.advice()[i])
+            throw Mismatch(fmt::format("advice of expert {}: {} vs {}", i,
+                                       ref.advice()[i], var.advice()[i]));
+        if (!close(ref.scores()[i], var.scores()[i], tol))
+            throw Mismatch(fmt::format("score of expert {}: {} vs {}", i,
+                                       ref.scores()[i], var.scores()[i]));
+        if (!close(ref.pct_weights()[i], var.pct_weights()[i], tol))
+            throw Mismatch(fmt::format("weight of expert {}: {} vs {}", i,
+                                       ref.pct_weights()[i],
+                                       var.pct_weights()[i]));
+    }
+
+    // Experts with equal weights may be ranked in any order, so compare the
+    // weights found at each rank rather than the indices.
+    const auto &w = ref.pct_weights();
+    if (var.indices().size() < n)
+        throw Mismatch("ranking is too short");
+    for (size_t k = 0; k < n; k++) {
+        if (!close(w[ref.indices()[k]], w[var.indices()[k]], tol))
+            throw Mismatch(fmt::format("rank {}: expert {} vs {}", k,
+                                       ref.indices()[k], var.indices()[k]));
+    }
+
+    for (int a : {-1, 1}) {
+        if (!close(ref.action_pct_weight(a), var.action_pct_weight(a), tol))
+            throw Mismatch(fmt::format("mass of action {}: {} vs {}", a,
+                                       ref.action_pct_weight(a),
+                                       var.action_pct_weight(a)));
+    }
+}
+
+static const char *OPPONENTS[] = {"random",  "biased:0.8", "alternate",
+                                  "pattern:LLRLR", "mirror", "contrarian",
+                                  "stay:0.7"};
+
+static void usage() {
+    fmt::print(stderr,
+               "usage: mindreader-check [--games N] [--max-experts N] "
+               "[--max-rounds R]\n"
+               "                        [--tolerance T] [--seed S] "
+               "[--variant SUBSTRING]\n");
+}
+
+static CheckOptions parse_options(int argc, char **argv) {
+    CheckOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--games")
+            opts.games = std::stol(value);
+        else if (arg == "--max-experts")
+            opts.max_experts = std::stoul(value);
+        else if (arg == "--max-rounds")
+            opts.max_rounds = std::stoi(value);
+        else if (arg == "--tolerance")
+            opts.tolerance = std::stod(value);
+        else if (arg == "--seed")
+            opts.seed = std::stoull(value);
+        else if (arg == "--variant")
+            opts.filter = value;
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+    if (opts.max_experts < 1 || opts.max_rounds < 1)
+        throw std::invalid_argument("sizes must be positive");
+    return opts;
+}
+
+int main(int argc, char **argv) {
+    CheckOptions opts;
+    try {
+        opts = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-check: {}\n", e.what());
+        usage();
+        return 1;
+    }
+
+    std::vector<Variant> checked;
+    for (auto &v : variants()) {
+        if (v.name.find(opts.filter) != std::string::npos)
+            checked.push_back(v);
+    }
+
+    for (long g = 0; g < opts.games; g++) {
+        RandomStream dice(opts.seed, 2 * g);
+        size_t n = 1 + (size_t)(dice() * opts.max_experts);
+        int nrounds = 1 + (int)(dice() * opts.max_rounds);
+        std::string spec_name = OPPONENTS[(size_t)(dice() * 7)];
+        auto spec = PoolSpec::random(n, opts.seed ^ RandomStream::mix(g));
+        // Every eighth game plays the GUI pool instead, whose hand-picked
+        // grids a random pool never produces.
+        if (g % 8 == 7) {
+            spec = PoolSpec::defaults();
+            n = spec.size();
+        }
+
+        // One reference per loss mode; the sampled one plays the game.
+        using Reference = ReferenceAdvice<int, int>;
+        Reference ref(zero_one_loss, nrounds, spec.experts());
+        Reference expected_ref(zero_one_loss, nrounds, spec.experts(),
+                               LossMode::expected);
+        LearnerOf<Reference &> ref_view{ref};
+        LearnerOf<Reference &> expected_view{expected_ref};
+        auto reference = [&](const Variant &v) -> const Learner & {
+            if (v.mode == LossMode::expected)
+                return expected_view;
+            return ref_view;
+        };
+
+        std::vector<std::unique_ptr<Learner>> learners;
+        for (auto &v : checked) {
+            learners.push_back(v.make(spec, nrounds));
+        }
+
+        auto opponent = make_opponent(spec_name);
+        BitHistory predictions, outcomes;
+        seed_runif(opts.seed, 2 * g + 1);
+        for (auto r : {&ref, &expected_ref}) {
+            r->seed(opts.seed, 2 * g);
+            r->reset();
+        }
+        for (auto &l : learners) {
+            l->seed(opts.seed, 2 * g);
+            l->reset();
+        }
+
+        for (int round = 0; round <= nrounds; round++) {
+            for (size_t k = 0; k < learners.size(); k++) {
+                learners[k]->update_debug();
+                try {
+                    compare(reference(checked[k]), *learners[k],
+                            opts.tolerance);
+                } catch (const Mismatch &e) {
+                    fmt::print("FAIL {}: game {} ({} experts, opponent {}) "
+                               "round {}: {}\n",
+                               checked[k].name, g, n, spec_name, round,
+                               e.what());
+                    return 1;
+                }
+            }
+            if (round == nrounds)
+                break;
+
+            int y = opponent(predictions, outcomes);
+            int p = ref.predict();
+            int expected_p = expected_ref.predict();
+            for (size_t k = 0; k < learners.size(); k++) {
+                bool expected = checked[k].mode == LossMode::expected;
+                if (learners[k]->predict() != (expected ? expected_p : p))
+                    checked[k].prediction_mismatches++;
+                checked[k].rounds++;
+            }
+
+            ref.update(p, y);
+            expected_ref.update(p, y);
+            predictions.push_back(p);
+            outcomes.push_back(y);
+            for (auto &l : learners) {
+                l->update(p, y);
+            }
+        }
+    }
+
+    bool ok = true;
+    for (const auto &v : checked) {
+        fmt::print("{:<18} {} rounds, {} prediction mismatches\n", v.name,
+                   v.rounds, v.prediction_mismatches);
+        if (v.prediction_mismatches > 0)
+            ok = false;
+    }
+    fmt::print("{} games: {}\n", opts.games, ok ? "OK" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "pennies.h"
+#include "snapshot.h"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Context-tree weighting over the human's last moves: a Bayesian mixture of
+// every suffix model up to a given depth. Each context predicts with the
+// Krichevsky-Trofimov estimator, and each node of the tree mixes its own
+// estimate half and half with the product of its children's. A round costs
+// O(depth) and the tree holds one node per context seen, so deep patterns
+// are cheap where enumerating their models is not. Moves before the first
+// count as -1.
+struct ContextTreeExpert {
+    // Log probabilities of the moves seen in one context.
+    struct Node {
+        double minus = 0.0, plus = 0.0; // counts of -1 and 1
+        double log_pe = 0.0;            // KT estimate
+        double log_children = 0.0;      // sum of the children's log_pw
+        double log_pw = 0.0;            // weighted mixture
+    };
+
+    static constexpr int max_depth = 48;
+
+    int depth;
+    uint64_t context = 0; // 1 for each +1, the last move in bit 0
+    std::unordered_map<uint64_t, Node> nodes;
+    double q = 0.5; // probability of -1 next round
+
+    ContextTreeExpert(int depth) : depth{depth} {
+        if (depth < 0 || depth > max_depth)
+            throw std::invalid_argument("context tree depth out of range");
+    }
+
+    void reset() {
+        context = 0;
+        nodes.clear();
+        q = 0.5;
+    }
+
+    void observe(int /*prediction*/, int outcome) {
+        bool x = outcome > 0;
+        double child_old = 0.0, child_new = 0.0;
+        for (int d = depth; d >= 0; d--) {
+            auto &n = nodes[key(d)];
+            n.log_pe += log_kt(n, x);
+            (x ? n.plus : n.minus) += 1.0;
+
+            double old = n.log_pw;
+            if (d == depth) {
+                n.log_pw = n.log_pe;
+            } else {
+                n.log_children += child_new - child_old;
+                n.log_pw = mix(n.log_pe, n.log_children);
+            }
+            child_old = old;
+            child_new = n.log_pw;
+        }
+
+        context = context << 1 | x;
+        q = probability(false);
+    }
+
+    int operator()(double u) { return u <= q ? -1 : 1; }
+    void probabilities(double *out) { binary_probabilities(q, out); }
+
+    void save(SnapshotWriter &w) const {
+        std::vector<uint64_t> keys;
+        std::vector<Node> values;
+        for (const auto &kv : nodes) {
+            keys.push_back(kv.first);
+            values.push_back(kv.second);
+        }
+        w.put(context);
+        w.put(q);
+        w.put(keys);
+        w.put(values);
+    }
+
+    void load(SnapshotReader &r) {
+        std::vector<uint64_t> keys;
+        std::vector<Node> values;
+        r.get(context);
+        r.get(q);
+        r.get(keys);
+        r.get(values);
+        if (keys.size() != values.size())
+            throw SnapshotError("snapshot: corrupt context tree");
+        nodes.clear();
+        for (size_t i = 0; i < keys.size(); i++) {
+            nodes.emplace(keys[i], values[i]);
+        }
+    }
+
+  private:
+    // The context of the last d moves, tagged with its length.
+    uint64_t key(int d) const {
+        uint64_t top = (uint64_t)1 << d;
+        return top | (context & (top - 1));
+    }
+
+    static double log_kt(const Node &n, bool x) {
+        return std::log(((x ? n.plus : n.minus) + 0.5) /
+                        (n.minus + n.plus + 1.0));
+    }
+
+    // log(e^a / 2 + e^b / 2)
+    static double mix(double a, double b) {
+        double m = std::max(a, b);
+        return m + std::log1p(std::exp(-std::abs(a - b))) -
+               0.69314718055994530942;
+    }
+
+    // The probability that the next move is x: the ratio of the root's
+    // weighted probabilities with and without it, found along the path
+    // of the current context without changing the tree.
+    double probability(bool x) const {
+        double child_old = 0.0, child_new = 0.0;
+        for (int d = depth; d >= 0; d--) {
+            auto it = nodes.find(key(d));
+            Node n = it == nodes.end() ? Node{} : it->second;
+            double log_pe = n.log_pe + log_kt(n, x);
+            double log_pw = d == depth
+                                ? log_pe
+                                : mix(log_pe, n.log_children + child_new -
+                                                  child_old);
+            child_old = n.log_pw;
+            child_new = log_pw;
+        }
+        return std::exp(child_new - child_old);
+    }
+};
+
+// Context trees of several depths over the same moves.
+struct ContextTreeBank {
+    std::vector<ContextTreeExpert> trees;
+    ContextTreeBank(const std::vector<int> &depths) {
+        for (auto d : depths) {
+            trees.emplace_back(d);
+        }
+    }
+
+    size_t size() const { return trees.size(); }
+
+    void reset() {
+        for (auto &t : trees) {
+            t.reset();
+        }
+    }
+
+    void save(SnapshotWriter &w) const {
+        for (const auto &t : trees) {
+            t.save(w);
+        }
+    }
+
+    void load(SnapshotReader &r) {
+        for (auto &t : trees) {
+            t.load(r);
+        }
+    }
+
+    void observe(int prediction, int outcome) {
+        for (auto &t : trees) {
+            t.observe(prediction, outcome);
+        }
+    }
+
+    void advise(const double *u, int *out) {
+        for (size_t i = 0; i < size(); i++) {
+            out[i] = trees[i](u[i]);
+        }
+    }
+
+    void probabilities(double *q, size_t actions) {
+        for (size_t i = 0; i < size(); i++) {
+            trees[i].probabilities(q + i * actions);
+        }
+    }
+};
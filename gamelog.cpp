@@ -0,0 +1,92 @@
+#include "gamelog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static size_t packed_words(size_t rounds, size_t width) {
+    return (rounds * width + 63) / 64;
+}
+
+void append_game(const std::string &path, const GameRecord &game) {
+    uint32_t top = 0;
+    for (auto c : game.choices) {
+        top = std::max(top, c);
+    }
+    uint64_t width = 1;
+    while (width < 32 && top >> width != 0) {
+        width++;
+    }
+    std::vector<uint64_t> choices(packed_words(game.rounds(), width));
+    for (size_t i = 0; i < game.rounds(); i++) {
+        size_t bit = i * width;
+        choices[bit / 64] |= (uint64_t)game.choices[i] << (bit % 64);
+        if (bit % 64 + width > 64)
+            choices[bit / 64 + 1] |= (uint64_t)game.choices[i] >>
+                                     (64 - bit % 64);
+    }
+
+    SnapshotWriter w;
+    w.put(game_log_magic);
+    w.put(game_log_version);
+    w.put((uint64_t)game.rounds());
+    w.put(game.weights.empty() ? (uint64_t)0 : game.experts);
+    w.put(width);
+    w.put(game.predictions.words);
+    w.put(game.outcomes.words);
+    w.put(choices);
+    w.put(game.weights);
+
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0)
+        throw SnapshotError(path + ": " + std::strerror(errno));
+    size_t written = 0;
+    while (written < w.bytes.size()) {
+        ssize_t n =
+            write(fd, w.bytes.data() + written, w.bytes.size() - written);
+        if (n < 0) {
+            close(fd);
+            throw SnapshotError(path + ": " + std::strerror(errno));
+        }
+        written += n;
+    }
+    close(fd);
+}
+
+GameLog::GameLog(const std::string &path) : file{path} {
+    SnapshotReader r(file.data, file.size);
+    while (!r.done()) {
+        if (r.get<uint64_t>() != game_log_magic)
+            throw SnapshotError(path + ": not a game log");
+        if (r.get<uint64_t>() != game_log_version)
+            throw SnapshotError(path + ": unsupported game log version");
+
+        GameView g;
+        g.rounds = r.get<uint64_t>();
+        g.experts = r.get<uint64_t>();
+        g.choice_width = r.get<uint64_t>();
+        if (g.choice_width == 0 || g.choice_width > 32)
+            throw SnapshotError(path + ": corrupt game log");
+        size_t words = packed_words(g.rounds, 1);
+        size_t choice_words = packed_words(g.rounds, g.choice_width);
+
+        auto column = [&](size_t expected) {
+            if (r.get<uint64_t>() != expected)
+                throw SnapshotError(path + ": corrupt game log");
+        };
+        column(words);
+        g.predictions = r.view<uint64_t>(words);
+        column(words);
+        g.outcomes = r.view<uint64_t>(words);
+        column(choice_words);
+        g.choices = r.view<uint64_t>(choice_words);
+        column(g.rounds * g.experts);
+        g.weights = r.view<float>(g.rounds * g.experts);
+        if (g.experts == 0)
+            g.weights = nullptr;
+
+        games.push_back(g);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "history.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Game logs: an append-only file of recorded games, one block of columns
+// per game. Every column is a length followed by its values, padded to 8
+// bytes:
+//
+//   magic, version, rounds, experts, choice width
+//   predictions   the machine's moves, bit-packed as in BitHistory
+//   outcomes      the human's moves, bit-packed
+//   choices       the expert the machine followed each round, packed in
+//                 choice width bits apiece
+//   weights       float per expert per round, in percent; may be empty
+//
+// A reader maps the file and uses every column in place.
+
+constexpr uint64_t game_log_magic = 0x474f4c44524dull; // "MRDLOG"
+constexpr uint64_t game_log_version = 1;
+
+struct GameRecord {
+    BitHistory predictions, outcomes;
+    std::vector<uint32_t> choices;
+    std::vector<float> weights;
+    uint64_t experts = 0;
+
+    size_t rounds() const { return outcomes.size(); }
+
+    void clear() {
+        predictions.clear();
+        outcomes.clear();
+        choices.clear();
+        weights.clear();
+    }
+
+    // Records one round, with the experts' weights if pct_weights is given.
+    void add(int prediction, int outcome, size_t choice,
+             const std::vector<double> *pct_weights = nullptr) {
+        predictions.push_back(prediction);
+        outcomes.push_back(outcome);
+        choices.push_back((uint32_t)choice);
+        if (pct_weights) {
+            experts = pct_weights->size();
+            weights.insert(weights.end(), pct_weights->begin(),
+                           pct_weights->end());
+        }
+    }
+};
+
+// Appends a game to the log at path, creating the file if needed. Each game
+// is written with a single write() to a file opened with O_APPEND.
+void append_game(const std::string &path, const GameRecord &game);
+
+// One game of a mapped log; the columns point into the file.
+struct GameView {
+    size_t rounds = 0;
+    size_t experts = 0;
+    size_t choice_width = 0;
+    const uint64_t *predictions = nullptr;
+    const uint64_t *outcomes = nullptr;
+    const uint64_t *choices = nullptr;
+    const float *weights = nullptr; // null if not recorded
+
+    int prediction(size_t i) const {
+        return predictions[i / 64] >> (i % 64) & 1 ? 1 : -1;
+    }
+    int outcome(size_t i) const {
+        return outcomes[i / 64] >> (i % 64) & 1 ? 1 : -1;
+    }
+    size_t choice(size_t i) const {
+        size_t bit = i * choice_width, w = bit / 64, shift = bit % 64;
+        uint64_t x = choices[w] >> shift;
+        if (shift + choice_width > 64)
+            x |= choices[w + 1] << (64 - shift);
+        return x & (((uint64_t)1 << choice_width) - 1);
+    }
+    const float *weights_at(size_t i) const {
+        return weights ? weights + i * experts : nullptr;
+    }
+};
+
+// A mapped game log. Throws SnapshotError if the file is not a valid log.
+struct GameLog {
+    MappedFile file;
+    std::vector<GameView> games;
+
+    GameLog(const std::string &path);
+};
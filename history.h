@@ -0,0 +1,157 @@
+#pragma once
+
+#include "actions.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// The history of a binary game, one bit per round packed into 64-bit words:
+// 1 for +1, 0 for -1. Round i is bit i % 64 of word i / 64, and bits past
+// the end are kept zero. Besides the vector-like members it answers the
+// questions pattern experts ask with word operations.
+//
+// A bounded history keeps only its last words in a ring: size() still
+// counts every round, but only rounds from first() on can be read.
+struct BitHistory {
+    std::vector<uint64_t> words;
+    size_t n = 0;
+    size_t limit = 0; // words kept, or 0 for all of them
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    void clear() {
+        words.clear();
+        n = 0;
+    }
+
+    // Keeps at least the last max(rounds, 64) rounds from now on.
+    void bound(size_t rounds) {
+        clear();
+        limit = (std::max<size_t>(rounds, 64) + 63) / 64 + 1;
+    }
+
+    void reserve(size_t rounds) { words.reserve((rounds + 63) / 64); }
+    auto state() { return std::tie(n, limit, words); }
+
+    void push_back(int a) {
+        if (n % 64 == 0) {
+            if (limit == 0 || words.size() < limit)
+                words.push_back(0);
+            else
+                word(n / 64) = 0;
+        }
+        word(n / 64) |= (uint64_t)(a > 0) << (n % 64);
+        n++;
+    }
+
+    size_t first() const {
+        size_t used = (n + 63) / 64;
+        return used > words.size() ? (used - words.size()) * 64 : 0;
+    }
+
+    bool bit(size_t i) const { return word(i / 64) >> (i % 64) & 1; }
+    int operator[](size_t i) const { return bit(i) ? 1 : -1; }
+    int back() const { return (*this)[n - 1]; }
+
+    // The last k <= 64 rounds as bits, most recent in bit k - 1, so that
+    // context(k) == context(k + 1) >> 1. Rounds before the first are 0.
+    uint64_t context(size_t k) const {
+        if (k == 0)
+            return 0;
+        if (k > n)
+            return context(n) << (k - n);
+        size_t start = n - k, w = start / 64, shift = start % 64;
+        uint64_t x = word(w) >> shift;
+        if (shift + k > 64)
+            x |= word(w + 1) << (64 - shift);
+        return k == 64 ? x : (x & (((uint64_t)1 << k) - 1));
+    }
+
+    // The number of +1 rounds among the last k, or all retained ones.
+    size_t count(size_t k = SIZE_MAX) const {
+        size_t start = std::max(k >= n ? 0 : n - k, first());
+        size_t w = start / 64, end = (n + 63) / 64, total = 0;
+        if (w >= end)
+            return 0;
+        total += __builtin_popcountll(word(w) >> (start % 64));
+        for (w++; w < end; w++) {
+            total += __builtin_popcountll(word(w));
+        }
+        return total;
+    }
+
+    // The length of the run of equal rounds that ends the history, counted
+    // back to first() at most.
+    size_t streak() const {
+        if (n == 0)
+            return 0;
+        uint64_t flip = bit(n - 1) ? ~(uint64_t)0 : 0;
+        size_t last = (n - 1) % 64, run = 0;
+        for (size_t w = (n - 1) / 64;; w--) {
+            // Rounds that differ from the last one, up to bit `last`.
+            uint64_t mask = ~(uint64_t)0 >> (63 - last);
+            uint64_t differ = (word(w) ^ flip) & mask;
+            if (differ != 0)
+                return run + last - (63 - __builtin_clzll(differ));
+            run += last + 1;
+            if (w * 64 == first())
+                return run;
+            last = 63;
+        }
+    }
+
+  private:
+    uint64_t &word(size_t w) { return words[limit ? w % limit : w]; }
+    uint64_t word(size_t w) const { return words[limit ? w % limit : w]; }
+};
+
+// The history of any other game, in a vector that a bounded history uses as
+// a ring of its last rounds. Indices count from the start of the game.
+template <typename T> struct RingHistory {
+    std::vector<T> items;
+    size_t n = 0;
+    size_t limit = 0; // rounds kept, or 0 for all of them
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    void clear() {
+        items.clear();
+        n = 0;
+    }
+
+    void bound(size_t rounds) {
+        clear();
+        limit = std::max<size_t>(rounds, 1);
+    }
+
+    void reserve(size_t rounds) { items.reserve(rounds); }
+    auto state() { return std::tie(n, limit, items); }
+
+    void push_back(const T &a) {
+        if (limit == 0 || items.size() < limit)
+            items.push_back(a);
+        else
+            items[n % limit] = a;
+        n++;
+    }
+
+    size_t first() const { return n - items.size(); }
+
+    const T &operator[](size_t i) const {
+        return items[limit ? i % limit : i];
+    }
+    const T &back() const { return (*this)[n - 1]; }
+};
+
+// The container ExpertAdvice keeps a history of T in.
+template <typename T, typename Actions> struct history_of {
+    using type = RingHistory<T>;
+};
+
+template <> struct history_of<int, BinaryActions> {
+    using type = BitHistory;
+};
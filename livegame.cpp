@@ -0,0 +1,113 @@
+#include "livegame.h"
+#include <cstdio>
+#include <exception>
+
+LiveGame::LiveGame(ExpertPool pool, int nrounds, std::string log_path,
+                   size_t top)
+    : m_labels{pool.labels}, m_log_path{std::move(log_path)}, m_top{top},
+      m_learner(zero_one_loss, nrounds, std::move(pool.banks),
+                pool.labels) {
+    publish();
+    m_thread = std::thread([this] { run(); });
+}
+
+LiveGame::~LiveGame() {
+    push({Command::stop, 0});
+    m_thread.join();
+}
+
+void LiveGame::move(int outcome) { push({Command::move, outcome}); }
+
+void LiveGame::new_game() { push({Command::new_game, 0}); }
+
+void LiveGame::push(Command c) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_commands.push_back(c);
+    }
+    m_wake.notify_one();
+}
+
+// Takes in every queued command, then publishes once, so that a burst of
+// moves costs one round of statistics.
+void LiveGame::run() {
+    while (true) {
+        Command c;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_commands.empty()) {
+                lock.unlock();
+                publish();
+                lock.lock();
+                m_wake.wait(lock, [this] { return !m_commands.empty(); });
+            }
+            c = m_commands.front();
+            m_commands.pop_front();
+        }
+
+        if (c.kind == Command::stop)
+            break;
+        if (c.kind == Command::new_game) {
+            save_game();
+            m_learner.reset();
+        } else {
+            play(c.outcome);
+        }
+    }
+    save_game();
+}
+
+// Moves that arrive after the game is decided are ignored.
+void LiveGame::play(int outcome) {
+    auto &E = m_learner;
+    if (!playing())
+        return;
+
+    auto p = E.predict();
+    m_record.add(p, outcome, E.last_choice());
+    E.update(p, outcome);
+    if (!playing())
+        save_game();
+}
+
+// Until the rounds run out or either side has won a majority of them.
+bool LiveGame::playing() const {
+    const auto &E = m_learner;
+    int human = (int)E.cumulative_loss;
+    int cpu = (int)E.round_counter - human;
+    return !E.gameover() && cpu <= E.nrounds / 2 && human <= E.nrounds / 2;
+}
+
+void LiveGame::save_game() {
+    if (m_record.rounds() == 0)
+        return;
+    try {
+        append_game(m_log_path, m_record);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+    }
+    m_record.clear();
+}
+
+void LiveGame::publish() {
+    auto &E = m_learner;
+    auto &v = m_views.back();
+    v.round = (int)E.round_counter;
+    v.nrounds = E.nrounds;
+    v.human_score = (int)E.cumulative_loss;
+    v.cpu_score = v.round - v.human_score;
+    v.playing = playing();
+    v.last_prediction = v.round > 0 ? E.predictions.back() : 0;
+    v.last_outcome = v.round > 0 ? E.outcomes.back() : 0;
+
+    v.top = E.ranking(m_top);
+    auto &w = E.pct_weights();
+    v.top_pct_weights.clear();
+    for (auto i : v.top) {
+        v.top_pct_weights.push_back(w[i]);
+    }
+    v.left = E.action_pct_weight(-1);
+    v.right = E.action_pct_weight(1);
+
+    m_views.publish();
+}
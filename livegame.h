@@ -0,0 +1,77 @@
+#pragma once
+
+#include "gamelog.h"
+#include "pennies.h"
+#include "pool.h"
+#include "triple_buffer.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What the GUI shows of a game, as of the last move the learner took in.
+struct LiveView {
+    int round = 0;
+    int nrounds = 0;
+    int human_score = 0;
+    int cpu_score = 0;
+    int last_prediction = 0; // 0 before the first round
+    int last_outcome = 0;
+    bool playing = true;
+    std::vector<size_t> top; // the best experts, best first
+    std::vector<double> top_pct_weights;
+    double left = 0.0, right = 0.0; // weight in percent behind each move
+};
+
+// A game of the GUI, played by a learner on a thread of its own so that a
+// large pool never holds up a frame. The UI queues the human's moves and
+// new games, and reads the newest LiveView, which the learner publishes
+// through a TripleBuffer once it has caught up with the queue. Neither side
+// waits for the other's work: the queue's lock is only held to push or pop.
+// Finished games are appended to the game log at log_path.
+struct LiveGame {
+    LiveGame(ExpertPool pool, int nrounds, std::string log_path,
+             size_t top = 50);
+    ~LiveGame();
+
+    LiveGame(const LiveGame &) = delete;
+    LiveGame &operator=(const LiveGame &) = delete;
+
+    void move(int outcome);
+    void new_game();
+
+    // The UI thread's view; valid until the next call.
+    const LiveView &view() { return m_views.latest(); }
+    const std::vector<std::string> &labels() const { return m_labels; }
+
+  private:
+    struct Command {
+        enum { move, new_game, stop } kind;
+        int outcome;
+    };
+
+    void push(Command c);
+    void run();
+    void play(int outcome);
+    bool playing() const;
+    void save_game();
+    void publish();
+
+    std::vector<std::string> m_labels;
+    std::string m_log_path;
+    size_t m_top;
+
+    // Owned by the learner thread once it runs.
+    ExpertAdvice<int, int, BinaryActions> m_learner;
+    GameRecord m_record;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Command> m_commands;
+
+    TripleBuffer<LiveView> m_views;
+    std::thread m_thread;
+};
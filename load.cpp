@@ -0,0 +1,232 @@
+#include "lib/fmt/include/fmt/format.h"
+#include "history.h"
+#include "opponent.h"
+#include "rng.h"
+#include "util.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load generator for mindreader-server: every client thread opens one
+// connection, starts its sessions, and plays them all round by round with
+// scripted opponents, pipelining a PREDICT and an UPDATE per session.
+
+struct LoadOptions {
+    std::string socket = "/tmp/mindreader.sock";
+    int clients = 4;
+    int sessions = 100;
+    int rounds = 101;
+    std::string opponent = "random";
+    uint64_t seed = 1;
+};
+
+struct Client {
+    int fd;
+    std::string buffer;
+
+    Client(const std::string &path) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof addr.sun_path - 1);
+        if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof addr) < 0)
+            throw std::runtime_error(path + ": " + std::strerror(errno));
+    }
+
+    ~Client() { close(fd); }
+
+    void send(const std::string &requests) {
+        size_t sent = 0;
+        while (sent < requests.size()) {
+            ssize_t w =
+                write(fd, requests.data() + sent, requests.size() - sent);
+            if (w <= 0)
+                throw std::runtime_error("write failed");
+            sent += w;
+        }
+    }
+
+    std::string receive() {
+        char chunk[65536];
+        size_t end;
+        while ((end = buffer.find('\n')) == std::string::npos) {
+            ssize_t r = read(fd, chunk, sizeof chunk);
+            if (r <= 0)
+                throw std::runtime_error("server closed the connection");
+            buffer.append(chunk, r);
+        }
+        std::string line = buffer.substr(0, end);
+        buffer.erase(0, end + 1);
+        if (line.rfind("OK", 0) != 0)
+            throw std::runtime_error("server: " + line);
+        return line.size() > 3 ? line.substr(3) : "";
+    }
+};
+
+struct ClientStats {
+    long requests = 0;
+    long rounds = 0;
+    long human_score = 0;
+};
+
+static ClientStats play(const LoadOptions &opts, int c) {
+    ClientStats stats;
+    Client client(opts.socket);
+    seed_runif(opts.seed, c);
+
+    std::string requests;
+    for (int s = 0; s < opts.sessions; s++) {
+        uint64_t game = (uint64_t)c * opts.sessions + s;
+        requests += fmt::format("NEW {} {}\n", opts.rounds,
+                                opts.seed ^ RandomStream::mix(game));
+    }
+    client.send(requests);
+
+    std::vector<std::string> ids(opts.sessions);
+    std::vector<BitHistory> predictions(opts.sessions), outcomes(ids.size());
+    std::vector<int> moves(opts.sessions);
+    for (auto &id : ids) {
+        id = client.receive();
+    }
+    stats.requests += opts.sessions;
+
+    auto opponent = make_opponent(opts.opponent);
+    for (int round = 0; round < opts.rounds; round++) {
+        requests.clear();
+        for (int s = 0; s < opts.sessions; s++) {
+            moves[s] = opponent(predictions[s], outcomes[s]);
+            requests += fmt::format("PREDICT {}\nUPDATE {} {}\n", ids[s],
+                                    ids[s], moves[s]);
+        }
+        client.send(requests);
+
+        for (int s = 0; s < opts.sessions; s++) {
+            predictions[s].push_back(std::stoi(client.receive()));
+            outcomes[s].push_back(moves[s]);
+            client.receive();
+        }
+        stats.requests += 2 * opts.sessions;
+        stats.rounds += opts.sessions;
+    }
+
+    requests.clear();
+    for (int s = 0; s < opts.sessions; s++) {
+        requests += fmt::format("STATS {}\nCLOSE {}\n", ids[s], ids[s]);
+    }
+    client.send(requests);
+    for (int s = 0; s < opts.sessions; s++) {
+        std::istringstream in(client.receive());
+        long rounds, human;
+        in >> rounds >> human;
+        stats.human_score += human;
+        client.receive();
+    }
+    stats.requests += 2 * opts.sessions;
+    return stats;
+}
+
+static void usage() {
+    fmt::print(stderr,
+               "usage: mindreader-load [--socket PATH] [--clients C] "
+               "[--sessions S] [--rounds R] [--opponent SPEC] [--seed S]\n");
+}
+
+static LoadOptions parse_options(int argc, char **argv) {
+    LoadOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--socket")
+            opts.socket = value;
+        else if (arg == "--clients")
+            opts.clients = std::stoi(value);
+        else if (arg == "--sessions")
+            opts.sessions = std::stoi(value);
+        else if (arg == "--rounds")
+            opts.rounds = std::stoi(value);
+        else if (arg == "--opponent")
+            opts.opponent = value;
+        else if (arg == "--seed")
+            opts.seed = std::stoull(value);
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+
+    if (opts.clients <= 0 || opts.sessions <= 0 || opts.rounds <= 0)
+        throw std::invalid_argument(
+            "clients, sessions and rounds must be positive");
+    return opts;
+}
+
+int main(int argc, char **argv) {
+    LoadOptions opts;
+    try {
+        opts = parse_options(argc, argv);
+        make_opponent(opts.opponent);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-load: {}\n", e.what());
+        usage();
+        return 1;
+    }
+
+    std::vector<ClientStats> stats(opts.clients);
+    std::vector<std::thread> clients;
+    std::atomic<bool> failed{false};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < opts.clients; c++) {
+        clients.emplace_back([&, c] {
+            try {
+                stats[c] = play(opts, c);
+            } catch (const std::exception &e) {
+                fmt::print(stderr, "mindreader-load: client {}: {}\n", c,
+                           e.what());
+                failed = true;
+            }
+        });
+    }
+    for (auto &c : clients) {
+        c.join();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+
+    ClientStats total;
+    for (const auto &s : stats) {
+        total.requests += s.requests;
+        total.rounds += s.rounds;
+        total.human_score += s.human_score;
+    }
+
+    fmt::print("clients         {}\n", opts.clients);
+    fmt::print("sessions        {}\n", (long)opts.clients * opts.sessions);
+    fmt::print("requests        {}\n", total.requests);
+    fmt::print("rounds          {}\n", total.rounds);
+    fmt::print("seconds         {:.3f}\n", seconds);
+    fmt::print("requests/sec    {:.1f}\n", total.requests / seconds);
+    fmt::print("rounds/sec      {:.1f}\n", total.rounds / seconds);
+    if (total.rounds > 0)
+        fmt::print("loss mean       {:.4f}\n",
+                   (double)total.human_score / total.rounds);
+    return failed ? 1 : 0;
+}
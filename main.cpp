@@ -16,9 +16,7 @@
 // Include glfw3.h after our OpenGL definitions
 #include <GLFW/glfw3.h>
 
-#include "util.h"
-
-#define PI 3.14159265358979323846
+#include "window.h"
 
 #if __APPLE__
 const char *glsl_version = "#version 150";
@@ -37,72 +35,21 @@ static void HelpMarker(const char *desc) {
     }
 }
 
-#include "pennies.h"
+#include "livegame.h"
+#include "pool.h"
 #include <algorithm>
 #include <cmath>
 #include <numeric>
 #include <string>
 
-int main() {
-    std::vector<double> grid;
-    for (double x = 0.0; x <= 1; x += 0.05) {
-        grid.push_back(x);
-    }
-    std::vector<double> grid2 = {0.1, 0.25, 0.4, 0.6, 0.75, 0.9};
-    std::vector<double> grid3 = {0.1, 0.3, 0.5, 0.7, 0.9};
-
-    std::vector<Expert<int, int>> experts;
-    std::vector<std::string> labels;
-
-    for (auto g : grid) {
-        experts.push_back(ProportionExpert(g));
-        labels.push_back(fmt::format("Proportion[{:.2f}]", g));
-    }
-
-    for (auto g : {0.9, 0.85, 0.8, 0.75, 0.7, 0.65, 0.6, 0.55, 0.5}) {
-        experts.push_back(ExponentialExpert(g));
-        labels.push_back(fmt::format("Exponential[{:.2f}]", g));
-    }
-
-    for (auto g : grid2) {
-        experts.push_back(StreakExpert(g));
-        labels.push_back(fmt::format("Streak[{:.2f}]", g));
-    }
-
-    for (auto g : grid2) {
-        experts.push_back(CorrelatedExpert(g));
-        labels.push_back(fmt::format("Correlated[{:.2f}]", g));
-    }
-
-    std::vector<double> omegas = {0.0, 0.5, 1.0, 1.5, 2.,  2.5, 3.,
-                                  3.5, 4.,  4.5, 5.,  5.5, 6.};
-    std::vector<double> phis = {-PI, -0.5 * PI, 0., 0.5 * PI, PI};
-
-    for (auto w : omegas) {
-        for (auto phi : phis) {
-            experts.push_back(CosineExpert(2 * PI / w, phi));
-            labels.push_back(fmt::format("Cosine[{:.2f} {:.2f}]", w, phi));
-        }
-    }
-
-    for (auto a : grid3) {
-        for (auto b : grid3) {
-            for (auto c : grid3) {
-                for (auto d : grid3) {
-                    if (runif() <= 2.2) {
-                        experts.push_back(LengthTwoExpert(a, b, c, d));
-                        labels.push_back(fmt::format(
-                            "LengthTwo[{:.2f} {:.2f} {:.2f} {:.2f}]", a, b,
-                            c, d));
-                    }
-                }
-            }
-        }
-    }
+// Every game played is appended here, for mindreader-replay.
+const char *game_log = "mindreader-games.log";
 
+int main() {
+    // The learner runs on its own thread; frames only read its LiveView.
     int n_rounds = 101;
-    int n_experts = experts.size();
-    auto E = ExpertAdvice<int, int>(zero_one_loss, n_rounds, experts, labels);
+    LiveGame game(default_pool(), n_rounds, game_log);
+    int n_experts = game.labels().size();
 
     InitializeOnce();
 
@@ -134,15 +81,13 @@ int main() {
     // Setup Dear ImGui style
     ImGui::StyleColorsDark();
 
-    int human_score = 0;
-    int cpu_score = 0;
-
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
         glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         int y = 0;
+        const auto &view = game.view();
 
         // feed inputs to dear imgui, start new frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -153,28 +98,22 @@ int main() {
         ImGui::Text("You");
         ImGui::SameLine(100);
         ImGui::Text("Mindreader");
-        ImGui::Text("%d", human_score);
+        ImGui::Text("%d", view.human_score);
         ImGui::SameLine(100);
-        ImGui::Text("%d", cpu_score);
+        ImGui::Text("%d", view.cpu_score);
 
         ImGui::Separator();
         ImGui::Spacing();
-        if (ImGui::Button("New Game")) {
-            E.reset();
-            human_score = 0;
-            cpu_score = 0;
-        }
+        if (ImGui::Button("New Game"))
+            game.new_game();
         ImGui::Text("Use the Left and Right arrow keys");
         ImGui::Spacing();
         ImGui::Separator();
         ImGui::Spacing();
-        ImGui::Text("Round %d out of %d", E.round_counter, E.nrounds);
-
-        bool gameover = E.gameover() == false && cpu_score <= E.nrounds / 2 &&
-                        human_score <= E.nrounds / 2;
+        ImGui::Text("Round %d out of %d", view.round, view.nrounds);
 
-        if (E.round_counter >= 1 && gameover) {
-            if (E.outcomes.back() == E.predictions.back()) {
+        if (view.round >= 1 && view.playing) {
+            if (view.last_outcome == view.last_prediction) {
                 ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.3f, 1.0f),
                                    "LOST last round");
             } else {
@@ -182,25 +121,21 @@ int main() {
                                    "WON last round");
             }
         }
-        if (gameover) {
+        if (view.playing) {
             if (ImGui::IsKeyPressed(262)) {
                 y = 1;
             } else if (ImGui::IsKeyPressed(263)) {
                 y = -1;
             }
-            if (y != 0) {
-                auto p = E.predict();
-                E.update(p, y);
-                cpu_score = E.round_counter - (int)E.cumulative_loss;
-                human_score = (int)E.cumulative_loss;
-            }
+            if (y != 0)
+                game.move(y);
         } else {
             ImGui::Spacing();
 
-            if (cpu_score > human_score) {
+            if (view.cpu_score > view.human_score) {
                 ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.3f, 1.0f),
                                    "You lost :(");
-            } else if (cpu_score < human_score) {
+            } else if (view.cpu_score < view.human_score) {
                 ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.3f, 1.0f),
                                    "You won :)!");
             } else {
@@ -221,27 +156,27 @@ int main() {
         ImGui::Separator();
         ImGui::Spacing();
 
-        for (auto i = 0; i < n_experts; i++) {
-            // for (auto i = 0; i < std::min(n_experts, 20); i++) {
-            auto j = E.m_indices[i];
-            ImGui::Text("%1.2f", E.m_pct_weights[j]);
+        for (size_t j = 0; j < view.top.size(); j++) {
+            ImGui::Text("%1.2f", view.top_pct_weights[j]);
             ImGui::SameLine(100);
-            ImGui::Text("%s", E.labels[j].c_str());
+            ImGui::Text("%s", game.labels()[view.top[j]].c_str());
         }
         ImGui::End();
 
         ImGui::Begin("Next Prediction", NULL);
 
-        if (E.m_action_pct_weights[-1] >= E.m_action_pct_weights[1]) {
+        double left = view.left;
+        double right = view.right;
+        if (left >= right) {
             ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.3f, 1.0f),
-                               "LEFT: %2.1f%%", E.m_action_pct_weights[-1]);
+                               "LEFT: %2.1f%%", left);
             ImGui::SameLine(120);
-            ImGui::Text("RIGHT: %2.1f%%", E.m_action_pct_weights[1]);
+            ImGui::Text("RIGHT: %2.1f%%", right);
         } else {
-            ImGui::Text("LEFT: %2.1f%%", E.m_action_pct_weights[-1]);
+            ImGui::Text("LEFT: %2.1f%%", left);
             ImGui::SameLine(120);
             ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.3f, 1.0f),
-                               "RIGHT: %2.1f%%", E.m_action_pct_weights[1]);
+                               "RIGHT: %2.1f%%", right);
         }
 
         ImGui::End();
@@ -0,0 +1,103 @@
+#include "opponent.h"
+#include "util.h"
+#include <stdexcept>
+
+static double parse_probability(const std::string &spec, size_t pos) {
+    double p = std::stod(spec.substr(pos));
+    if (p < 0.0 || p > 1.0)
+        throw std::invalid_argument("probability out of range: " + spec);
+    return p;
+}
+
+Opponent make_opponent(const std::string &spec) {
+    auto has_prefix = [&spec](const char *prefix) {
+        return spec.rfind(prefix, 0) == 0;
+    };
+
+    if (spec == "random") {
+        return [](const BitHistory &, const BitHistory &) {
+            return runif() <= 0.5 ? -1 : 1;
+        };
+    }
+
+    if (has_prefix("biased:")) {
+        double p = parse_probability(spec, 7);
+        return [p](const BitHistory &, const BitHistory &) {
+            return runif() <= p ? -1 : 1;
+        };
+    }
+
+    if (spec == "alternate") {
+        return [](const BitHistory &, const BitHistory &o) {
+            return o.size() % 2 == 0 ? -1 : 1;
+        };
+    }
+
+    if (has_prefix("pattern:")) {
+        std::vector<int> moves;
+        for (auto c : spec.substr(8)) {
+            if (c == 'L')
+                moves.push_back(-1);
+            else if (c == 'R')
+                moves.push_back(1);
+            else
+                throw std::invalid_argument("bad pattern: " + spec);
+        }
+        if (moves.empty())
+            throw std::invalid_argument("empty pattern: " + spec);
+        return [moves](const BitHistory &, const BitHistory &o) {
+            return moves[o.size() % moves.size()];
+        };
+    }
+
+    if (spec == "mirror") {
+        return [](const BitHistory &p, const BitHistory &) {
+            if (p.empty())
+                return runif() <= 0.5 ? -1 : 1;
+            return p.back();
+        };
+    }
+
+    if (spec == "contrarian") {
+        return [](const BitHistory &p, const BitHistory &) {
+            if (p.empty())
+                return runif() <= 0.5 ? -1 : 1;
+            return -p.back();
+        };
+    }
+
+    if (has_prefix("stay:")) {
+        double p = parse_probability(spec, 5);
+        return [p](const BitHistory &, const BitHistory &o) {
+            if (o.empty())
+                return runif() <= 0.5 ? -1 : 1;
+            return runif() <= p ? o.back() : -o.back();
+        };
+    }
+
+    throw std::invalid_argument("unknown opponent: " + spec);
+}
+
+GameResult play_game(ExpertAdvice<int, int, BinaryActions> &E,
+                     Opponent &opponent, GameRecord *record,
+                     bool record_weights) {
+    GameResult result;
+    E.reset();
+    if (record)
+        record->clear();
+
+    while (!E.gameover() && result.cpu_score <= E.nrounds / 2 &&
+           result.human_score <= E.nrounds / 2) {
+        int y = opponent(E.predictions, E.outcomes);
+        auto p = E.predict();
+        if (record)
+            record->add(p, y, E.last_choice(),
+                        record_weights ? &E.pct_weights() : nullptr);
+        E.update(p, y);
+        result.cpu_score = E.round_counter - (int)E.cumulative_loss;
+        result.human_score = (int)E.cumulative_loss;
+    }
+
+    result.rounds = E.round_counter;
+    return result;
+}
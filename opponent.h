@@ -0,0 +1,37 @@
+#pragma once
+
+#include "gamelog.h"
+#include "history.h"
+#include "pennies.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// A scripted human. It sees the history of the game so far (never the
+// prediction for the current round) and returns its next move, -1 or 1.
+using Opponent = std::function<int(const BitHistory &predictions,
+                                   const BitHistory &outcomes)>;
+
+// Builds an opponent from a short spec:
+//   random         fair coin
+//   biased:P       plays -1 with probability P
+//   alternate      -1, 1, -1, 1, ...
+//   pattern:LLR    repeats a fixed sequence of L (-1) and R (1)
+//   mirror         copies the machine's last prediction
+//   contrarian     plays against the machine's last prediction
+//   stay:P         repeats its last move with probability P
+// Throws std::invalid_argument for an unknown spec.
+Opponent make_opponent(const std::string &spec);
+
+struct GameResult {
+    int rounds = 0;
+    int human_score = 0;
+    int cpu_score = 0;
+};
+
+// Plays one game with the same rules as the GUI: it ends after nrounds or
+// as soon as either side has won a majority of them. Every round is added
+// to record if one is given, with the weights if record_weights is set.
+GameResult play_game(ExpertAdvice<int, int, BinaryActions> &E,
+                     Opponent &opponent, GameRecord *record = nullptr,
+                     bool record_weights = false);
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "banks.h"
+#include "history.h"
+#include "pennies.h"
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+// Pattern experts over the outcomes alone. Each keeps them as a BitHistory
+// bounded to the rounds it looks back on and reads it with word operations,
+// so a round costs a few popcounts whatever the window.
+
+// The share of -1 among the last k outcomes, or among all of them while
+// there are fewer; a fair coin before the first round.
+inline double window_probability(const BitHistory &outcomes, size_t k) {
+    size_t m = std::min(k, outcomes.size());
+    if (m == 0)
+        return 0.5;
+    return (double)(m - outcomes.count(k)) / m;
+}
+
+// Once r or more equal outcomes end the history, the run is expected to
+// break: the probability of -1 is 1 after a run of 1s and 0 after a run of
+// -1s. Shorter runs get a fair coin.
+inline double run_probability(const BitHistory &outcomes, size_t streak,
+                              size_t r) {
+    if (outcomes.empty() || streak < r)
+        return 0.5;
+    return outcomes.back() > 0 ? 1.0 : 0.0;
+}
+
+struct WindowExpert {
+    size_t k;
+    BitHistory outcomes;
+    WindowExpert(int k) : k{(size_t)std::max(k, 0)} {
+        outcomes.bound(this->k);
+    }
+
+    void reset() { outcomes.clear(); }
+    auto state() { return outcomes.state(); }
+
+    void observe(int /*prediction*/, int outcome) {
+        outcomes.push_back(outcome);
+    }
+
+    void probabilities(double *q) {
+        binary_probabilities(window_probability(outcomes, k), q);
+    }
+
+    int operator()(double u) {
+        return u <= window_probability(outcomes, k) ? -1 : 1;
+    }
+};
+
+struct RunExpert {
+    size_t r;
+    BitHistory outcomes;
+    RunExpert(int r) : r{(size_t)std::max(r, 0)} {
+        outcomes.bound(this->r);
+    }
+
+    void reset() { outcomes.clear(); }
+    auto state() { return outcomes.state(); }
+
+    void observe(int /*prediction*/, int outcome) {
+        outcomes.push_back(outcome);
+    }
+
+    void probabilities(double *q) {
+        binary_probabilities(run_probability(outcomes, outcomes.streak(), r),
+                             q);
+    }
+
+    int operator()(double u) {
+        return u <= run_probability(outcomes, outcomes.streak(), r) ? -1 : 1;
+    }
+};
+
+// Window experts with several k, sharing one history as long as the
+// longest window.
+struct WindowBank {
+    std::vector<size_t> k;
+    BitHistory outcomes;
+    std::vector<double> q;
+    WindowBank(const std::vector<int> &windows) : q(windows.size()) {
+        for (auto w : windows) {
+            k.push_back((size_t)std::max(w, 0));
+        }
+        outcomes.bound(k.empty() ? 0 : *std::max_element(k.begin(), k.end()));
+    }
+
+    size_t size() const { return k.size(); }
+    void reset() { outcomes.clear(); }
+    auto state() { return outcomes.state(); }
+
+    void observe(int /*prediction*/, int outcome) {
+        outcomes.push_back(outcome);
+    }
+
+    void advise(const double *u, int *out) {
+        update_q();
+        threshold_advice(u, q.data(), out, size());
+    }
+
+    void probabilities(double *out, size_t actions) {
+        update_q();
+        threshold_probabilities(q.data(), out, actions, size());
+    }
+
+  private:
+    void update_q() {
+        for (size_t i = 0; i < size(); i++) {
+            q[i] = window_probability(outcomes, k[i]);
+        }
+    }
+};
+
+// Run experts with several r; the streak is counted once per round.
+struct RunBank {
+    std::vector<size_t> r;
+    BitHistory outcomes;
+    std::vector<double> q;
+    RunBank(const std::vector<int> &runs) : q(runs.size()) {
+        for (auto x : runs) {
+            r.push_back((size_t)std::max(x, 0));
+        }
+        outcomes.bound(r.empty() ? 0 : *std::max_element(r.begin(), r.end()));
+    }
+
+    size_t size() const { return r.size(); }
+    void reset() { outcomes.clear(); }
+    auto state() { return outcomes.state(); }
+
+    void observe(int /*prediction*/, int outcome) {
+        outcomes.push_back(outcome);
+    }
+
+    void advise(const double *u, int *out) {
+        update_q();
+        threshold_advice(u, q.data(), out, size());
+    }
+
+    void probabilities(double *out, size_t actions) {
+        update_q();
+        threshold_probabilities(q.data(), out, actions, size());
+    }
+
+  private:
+    void update_q() {
+        size_t streak = outcomes.streak();
+        for (size_t i = 0; i < size(); i++) {
+            q[i] = run_probability(outcomes, streak, r[i]);
+        }
+    }
+};
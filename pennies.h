@@ -1,11 +1,26 @@
+#pragma once
+
+#include "actions.h"
+#include "history.h"
+#include "ranking.h"
+#include "rng.h"
+#include "sampler.h"
+#include "scheduler.h"
+#include "snapshot.h"
 #include "util.h"
+#include "weights.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <functional>
-#include <map>
 #include <memory>
 #include <numeric>
+#include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 template <typename T>
@@ -22,128 +37,1169 @@ std::vector<size_t> sort_indexes(const std::vector<T> &v) {
     return idx;
 }
 
+// An expert is either
+//
+//   - a history function A(predictions, outcomes, round), called with the
+//     full history every round, or
+//   - a stateful expert with members
+//         A operator()(double u);
+//         void observe(const A &prediction, const Y &outcome);
+//         void reset();
+//     which is told about each round as it is played and keeps whatever
+//     running state it needs, so that its advice costs O(1) per round.
+//     Its randomness comes from the uniform u in [0, 1) handed to it by
+//     the learner, which makes games replayable from a seed. A nullary
+//     operator() is also accepted for experts that need no uniform.
+//
+// A history function that only looks at its last L rounds can say so with
+// a member size_t lookback() const returning L; it is then handed (at
+// least) those rounds, with round counting what it was handed. Without
+// one it gets the whole game.
+//
+// Stateful experts expose their running state for snapshots through
+// state() (see snapshot.h).
+//
+// A stateful expert over a finite alphabet (actions.h) may also describe
+// its advice as a distribution, with a member
+//
+//     void probabilities(double *q);
+//
+// writing the probability of each action, in the alphabet's index order.
+// A learner charging expected loss then uses it instead of a draw.
+//
+// Expert<A, Y> type-erases both kinds behind one interface.
+template <typename E, typename A, typename Y, typename = void>
+struct is_stateful_expert : std::false_type {};
+
+template <typename E, typename A, typename Y>
+struct is_stateful_expert<
+    E, A, Y,
+    std::void_t<decltype(std::declval<E &>().observe(std::declval<A>(),
+                                                     std::declval<Y>())),
+                decltype(std::declval<E &>().reset())>> : std::true_type {};
+
+template <typename T, typename = void>
+struct has_lookback : std::false_type {};
+
+template <typename T>
+struct has_lookback<
+    T, std::void_t<decltype(std::declval<const T &>().lookback())>>
+    : std::true_type {};
+
+template <typename E, typename = void>
+struct is_probabilistic_expert : std::false_type {};
+
+template <typename E>
+struct is_probabilistic_expert<
+    E, std::void_t<decltype(std::declval<E &>().probabilities(
+           std::declval<double *>()))>> : std::true_type {};
+
+template <typename A, typename Y> struct Expert {
+    template <typename E,
+              typename = std::enable_if_t<
+                  !std::is_same<std::decay_t<E>, Expert>::value &&
+                  (is_stateful_expert<std::decay_t<E>, A, Y>::value ||
+                   std::is_invocable_r<A, std::decay_t<E> &,
+                                       const std::vector<A> &,
+                                       const std::vector<Y> &, int>::value)>>
+    Expert(E &&e)
+        : self{std::make_unique<Model<std::decay_t<E>>>(std::forward<E>(e))} {
+    }
+
+    Expert(const Expert &other) : self{other.self->clone()} {}
+    Expert(Expert &&other) = default;
+
+    Expert &operator=(const Expert &other) {
+        self = other.self->clone();
+        return *this;
+    }
+    Expert &operator=(Expert &&other) = default;
+
+    void reset() { self->reset(); }
+
+    // The rounds of history the expert reads: 0 for stateful experts.
+    size_t lookback() const { return self->lookback(); }
+
+    // Whether probabilities() is available; it throws std::logic_error
+    // for experts that only give sampled advice.
+    bool probabilistic() const { return self->probabilistic(); }
+    void probabilities(double *q) { self->probabilities(q); }
+
+    void save(SnapshotWriter &w) const { self->save(w); }
+    void load(SnapshotReader &r) { self->load(r); }
+
+    void observe(const A &prediction, const Y &outcome) {
+        self->observe(prediction, outcome);
+    }
+
+    A operator()(const std::vector<A> &predictions,
+                 const std::vector<Y> &outcomes, int n, double u) {
+        return self->advise(predictions, outcomes, n, u);
+    }
+
+  private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual std::unique_ptr<Concept> clone() const = 0;
+        virtual void reset() = 0;
+        virtual size_t lookback() const = 0;
+        virtual bool probabilistic() const = 0;
+        virtual void probabilities(double *q) = 0;
+        virtual void save(SnapshotWriter &w) const = 0;
+        virtual void load(SnapshotReader &r) = 0;
+        virtual void observe(const A &prediction, const Y &outcome) = 0;
+        virtual A advise(const std::vector<A> &predictions,
+                         const std::vector<Y> &outcomes, int n,
+                         double u) = 0;
+    };
+
+    template <typename E> struct Model : Concept {
+        E e;
+        Model(E e) : e{std::move(e)} {}
+
+        std::unique_ptr<Concept> clone() const override {
+            return std::make_unique<Model>(e);
+        }
+
+        void reset() override {
+            if constexpr (is_stateful_expert<E, A, Y>::value)
+                e.reset();
+        }
+
+        size_t lookback() const override {
+            if constexpr (is_stateful_expert<E, A, Y>::value)
+                return 0;
+            else if constexpr (has_lookback<E>::value)
+                return e.lookback();
+            else
+                return SIZE_MAX;
+        }
+
+        bool probabilistic() const override {
+            return is_probabilistic_expert<E>::value;
+        }
+
+        void probabilities(double *q) override {
+            if constexpr (is_probabilistic_expert<E>::value)
+                e.probabilities(q);
+            else
+                throw std::logic_error("expert has no probabilities");
+        }
+
+        void save(SnapshotWriter &w) const override { save_state(w, e); }
+        void load(SnapshotReader &r) override { load_state(r, e); }
+
+        void observe(const A &prediction, const Y &outcome) override {
+            if constexpr (is_stateful_expert<E, A, Y>::value)
+                e.observe(prediction, outcome);
+        }
+
+        A advise(const std::vector<A> &predictions,
+                 const std::vector<Y> &outcomes, int n, double u) override {
+            if constexpr (!is_stateful_expert<E, A, Y>::value)
+                return e(predictions, outcomes, n);
+            else if constexpr (std::is_invocable<E &, double>::value)
+                return e(u);
+            else
+                return e();
+        }
+    };
+
+    std::unique_ptr<Concept> self;
+};
+
+// A bank is a group of experts evaluated together. Banks write the advice
+// of all their members at once, which lets a family of experts keep its
+// parameters and state in contiguous arrays and compute every member in one
+// loop. A bank has members
+//
+//   size_t size() const;
+//   void reset();
+//   void observe(const A &prediction, const Y &outcome);
+//   void advise(const double *u, A *out);
+//
+// where u holds one uniform per member for this round, and ExpertBank<A, Y>
+// type-erases it. Banks are told about every round through observe() and
+// keep whatever history they need themselves. A bank may also declare
+//
+//   size_t lookback() const;
+//
+// the rounds of history its experts look back on, SIZE_MAX for all of
+// them; without it the bank is taken to need none. Stateful banks expose
+// their state for snapshots like stateful experts do. Like an expert, a
+// bank may describe its advice as distributions,
+//
+//   void probabilities(double *q, size_t actions);
+//
+// writing actions probabilities per member, member by member; a bank that
+// can only sometimes do so also declares bool probabilistic() const.
+template <typename B, typename A, typename Y, typename = void>
+struct is_expert_bank : std::false_type {};
+
+template <typename B, typename A, typename Y>
+struct is_expert_bank<
+    B, A, Y,
+    std::void_t<decltype(std::declval<const B &>().size()),
+                decltype(std::declval<B &>().reset()),
+                decltype(std::declval<B &>().observe(std::declval<A>(),
+                                                     std::declval<Y>())),
+                decltype(std::declval<B &>().advise(
+                    std::declval<const double *>(),
+                    std::declval<A *>()))>> : std::true_type {};
+
+template <typename B, typename = void>
+struct is_probabilistic_bank : std::false_type {};
+
+template <typename B>
+struct is_probabilistic_bank<
+    B, std::void_t<decltype(std::declval<B &>().probabilities(
+           std::declval<double *>(), std::declval<size_t>()))>>
+    : std::true_type {};
+
+template <typename B, typename = void>
+struct has_probabilistic : std::false_type {};
+
+template <typename B>
+struct has_probabilistic<
+    B, std::void_t<decltype(std::declval<const B &>().probabilistic())>>
+    : std::true_type {};
+
+template <typename A, typename Y> struct ExpertBank {
+    template <typename B,
+              typename = std::enable_if_t<
+                  !std::is_same<std::decay_t<B>, ExpertBank>::value &&
+                  is_expert_bank<std::decay_t<B>, A, Y>::value>>
+    ExpertBank(B &&b)
+        : self{std::make_unique<Model<std::decay_t<B>>>(std::forward<B>(b))} {
+    }
+
+    ExpertBank(const ExpertBank &other) : self{other.self->clone()} {}
+    ExpertBank(ExpertBank &&other) = default;
+
+    ExpertBank &operator=(const ExpertBank &other) {
+        self = other.self->clone();
+        return *this;
+    }
+    ExpertBank &operator=(ExpertBank &&other) = default;
+
+    size_t size() const { return self->size(); }
+    size_t lookback() const { return self->lookback(); }
+
+    bool probabilistic() const { return self->probabilistic(); }
+    void probabilities(double *q, size_t actions) {
+        self->probabilities(q, actions);
+    }
+
+    void save(SnapshotWriter &w) const { self->save(w); }
+    void load(SnapshotReader &r) { self->load(r); }
+
+    void reset() { self->reset(); }
+
+    void observe(const A &prediction, const Y &outcome) {
+        self->observe(prediction, outcome);
+    }
+
+    void advise(const double *u, A *out) { self->advise(u, out); }
+
+  private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual std::unique_ptr<Concept> clone() const = 0;
+        virtual size_t size() const = 0;
+        virtual size_t lookback() const = 0;
+        virtual bool probabilistic() const = 0;
+        virtual void probabilities(double *q, size_t actions) = 0;
+        virtual void save(SnapshotWriter &w) const = 0;
+        virtual void load(SnapshotReader &r) = 0;
+        virtual void reset() = 0;
+        virtual void observe(const A &prediction, const Y &outcome) = 0;
+        virtual void advise(const double *u, A *out) = 0;
+    };
+
+    template <typename B> struct Model : Concept {
+        B b;
+        Model(B b) : b{std::move(b)} {}
+
+        std::unique_ptr<Concept> clone() const override {
+            return std::make_unique<Model>(b);
+        }
+
+        size_t size() const override { return b.size(); }
+        void reset() override { b.reset(); }
+
+        size_t lookback() const override {
+            if constexpr (has_lookback<B>::value)
+                return b.lookback();
+            else
+                return 0;
+        }
+
+        bool probabilistic() const override {
+            if constexpr (has_probabilistic<B>::value)
+                return b.probabilistic();
+            else
+                return is_probabilistic_bank<B>::value;
+        }
+
+        void probabilities(double *q, size_t actions) override {
+            if constexpr (is_probabilistic_bank<B>::value)
+                b.probabilities(q, actions);
+            else
+                throw std::logic_error("bank has no probabilities");
+        }
+
+        void save(SnapshotWriter &w) const override { save_state(w, b); }
+        void load(SnapshotReader &r) override { load_state(r, b); }
+
+        void observe(const A &prediction, const Y &outcome) override {
+            b.observe(prediction, outcome);
+        }
+
+        void advise(const double *u, A *out) override { b.advise(u, out); }
+    };
+
+    std::unique_ptr<Concept> self;
+};
+
+// A bank of individually type-erased experts, called one at a time. It
+// keeps the history its history-function experts look back on: all of it,
+// or, when every one of them declares a lookback, between one and two
+// times the longest.
+template <typename A, typename Y> struct ExpertListBank {
+    std::vector<Expert<A, Y>> experts;
+    std::vector<A> predictions;
+    std::vector<Y> outcomes;
+    size_t m_lookback = 0;
+    ExpertListBank(std::vector<Expert<A, Y>> experts)
+        : experts{std::move(experts)} {
+        for (const auto &e : this->experts) {
+            m_lookback = std::max(m_lookback, e.lookback());
+        }
+    }
+
+    size_t size() const { return experts.size(); }
+    size_t lookback() const { return m_lookback; }
+
+    bool probabilistic() const {
+        return std::all_of(experts.begin(), experts.end(),
+                           [](const auto &e) { return e.probabilistic(); });
+    }
+
+    void probabilities(double *q, size_t actions) {
+        for (auto &e : experts) {
+            e.probabilities(q);
+            q += actions;
+        }
+    }
+
+    void save(SnapshotWriter &w) const {
+        w.put(predictions);
+        w.put(outcomes);
+        for (const auto &e : experts) {
+            e.save(w);
+        }
+    }
+
+    void load(SnapshotReader &r) {
+        r.get(predictions);
+        r.get(outcomes);
+        for (auto &e : experts) {
+            e.load(r);
+        }
+    }
+
+    void reset() {
+        predictions.clear();
+        outcomes.clear();
+        for (auto &e : experts) {
+            e.reset();
+        }
+    }
+
+    void observe(const A &prediction, const Y &outcome) {
+        if (m_lookback > 0) {
+            if (m_lookback < SIZE_MAX / 2 &&
+                outcomes.size() >= 2 * m_lookback) {
+                auto drop = outcomes.size() - m_lookback;
+                predictions.erase(predictions.begin(),
+                                  predictions.begin() + drop);
+                outcomes.erase(outcomes.begin(), outcomes.begin() + drop);
+            }
+            predictions.push_back(prediction);
+            outcomes.push_back(outcome);
+        }
+        for (auto &e : experts) {
+            e.observe(prediction, outcome);
+        }
+    }
+
+    void advise(const double *u, A *out) {
+        int n = (int)outcomes.size();
+        for (auto &e : experts) {
+            *out++ = e(predictions, outcomes, n, *u++);
+        }
+    }
+};
+
+// Banks combined at compile time into one. Every call reaches each member
+// bank directly, in the order of the types, so a whole pool behind one
+// ExpertBank costs one indirect call per round and the compiler sees every
+// family's loop. Dynamic pools keep using a vector of ExpertBanks.
+template <typename... B> struct StaticBank {
+    std::tuple<B...> banks;
+    StaticBank(B... banks) : banks{std::move(banks)...} {}
+
+    size_t size() const {
+        size_t n = 0;
+        each([&n](const auto &b) { n += b.size(); });
+        return n;
+    }
+
+    size_t lookback() const {
+        size_t n = 0;
+        each([&n](const auto &b) {
+            if constexpr (has_lookback<std::decay_t<decltype(b)>>::value)
+                n = std::max(n, b.lookback());
+        });
+        return n;
+    }
+
+    bool probabilistic() const {
+        bool all = true;
+        each([&all](const auto &b) {
+            using Bank = std::decay_t<decltype(b)>;
+            if constexpr (has_probabilistic<Bank>::value)
+                all = all && b.probabilistic();
+            else
+                all = all && is_probabilistic_bank<Bank>::value;
+        });
+        return all;
+    }
+
+    void save(SnapshotWriter &w) const {
+        each([&w](const auto &b) { save_state(w, b); });
+    }
+
+    void load(SnapshotReader &r) {
+        each([&r](auto &b) { load_state(r, b); });
+    }
+
+    void reset() {
+        each([](auto &b) { b.reset(); });
+    }
+
+    template <typename A, typename Y>
+    void observe(const A &prediction, const Y &outcome) {
+        each([&](auto &b) { b.observe(prediction, outcome); });
+    }
+
+    template <typename A> void advise(const double *u, A *out) {
+        each([&](auto &b) {
+            b.advise(u, out);
+            u += b.size();
+            out += b.size();
+        });
+    }
+
+    void probabilities(double *q, size_t actions) {
+        each([&](auto &b) {
+            if constexpr (is_probabilistic_bank<
+                              std::decay_t<decltype(b)>>::value)
+                b.probabilities(q, actions);
+            else
+                throw std::logic_error("bank has no probabilities");
+            q += b.size() * actions;
+        });
+    }
+
+  private:
+    template <typename F> void each(F f) {
+        std::apply([&f](auto &... b) { (f(b), ...); }, banks);
+    }
+    template <typename F> void each(F f) const {
+        std::apply([&f](const auto &... b) { (f(b), ...); }, banks);
+    }
+};
+
 template <typename A, typename Y>
-using Expert =
-    std::function<A(const std::vector<A> &, const std::vector<Y> &, int)>;
+size_t count_experts(const std::vector<ExpertBank<A, Y>> &banks) {
+    size_t n = 0;
+    for (const auto &b : banks) {
+        n += b.size();
+    }
+    return n;
+}
 
 template <typename A, typename Y>
 using LossFunction = std::function<double(A, Y)>;
 
-template <typename A, typename Y> struct ExpertAdvice {
-    std::vector<A> predictions;
-    std::vector<Y> outcomes;
+// What an expert is charged each round: the loss of its sampled advice, or
+// the expected loss of its distribution over the actions.
+enum class LossMode { sampled, expected };
+
+template <typename A, typename Y, typename Actions = SparseActions<A>>
+struct ExpertAdvice {
+    // Packed one bit per round for binary games.
+    typename history_of<A, Actions>::type predictions;
+    typename history_of<Y, Actions>::type outcomes;
     std::vector<A> advice;
 
     LossFunction<A, Y> loss_function;
+
+    // A game of nrounds rounds, or with nrounds == 0 a streaming session
+    // that never ends. Streaming tunes eta for a horizon that doubles each
+    // time it is reached, so eta changes O(log T) times and the weights are
+    // only rebuilt then. It also keeps only the last lookback() rounds of
+    // predictions and outcomes (64 for a BitHistory), so that memory stays
+    // constant as long as every bank declares how far back it looks.
     const int nrounds;
-    const double eta;
+    double eta;
+    double m_horizon;
+    size_t m_lookback;
 
     std::vector<double> scores;
-    std::vector<Expert<A, Y>> experts;
+    std::vector<ExpertBank<A, Y>> banks;
     std::vector<std::string> labels;
 
+    // With LossMode::expected, which needs a dense alphabet, every expert
+    // has a distribution over the actions in m_probabilities, and its
+    // score falls by the expected loss: a dot product with m_action_loss,
+    // the loss of each action. Probabilistic banks draw no uniforms and
+    // leave their advice unset; the others put all the probability on
+    // their sampled advice.
+    static constexpr bool dense =
+        !std::is_same<Actions, SparseActions<A>>::value;
+    const LossMode m_mode;
+    std::vector<bool> m_bank_probabilistic;
+    std::vector<double> m_probabilities;
+    std::vector<double> m_action_loss;
+
+    // Statistics for display: each expert's weight in percent, experts
+    // ranked by weight, and the weight behind each action. They are only
+    // computed on request, through update_debug() or the accessors below,
+    // so a learner nobody looks at never pays for them.
     std::vector<double> m_pct_weights;
     std::vector<size_t> m_indices;
-    std::map<A, double> m_action_pct_weights;
+    ActionWeights<A, Actions> m_action_pct_weights;
+    bool m_stats_valid = false;
 
-    int round_counter;
+    // Short rankings come from a tournament tree over the scores. Once
+    // built it takes point updates for the experts whose score changed,
+    // while there are at most about N / log N of them; past that they are
+    // no longer recorded and the next short ranking rebuilds the tree. A
+    // sampled round changes the score of every wrong expert, so updates
+    // pay off in rounds where nearly every expert was right, and when the
+    // ranking is read more than once between rounds.
+    TournamentTree m_ranking;
+    std::vector<size_t> m_rank_changed;
+    size_t m_rank_limit = 0;
+    bool m_ranking_valid = false;
+
+    int64_t round_counter;
     double cumulative_loss;
+    size_t m_choice = 0;
+
+    // Source of every uniform the learner uses: one block per round for the
+    // experts' advice, in expert order, then one per predict(). Seeding it
+    // before reset() makes a game replayable.
+    RandomStream rng;
+    std::vector<double> m_uniforms;
+
+    // Unnormalized weights exp(eta * (scores - m_weight_offset)) live in
+    // m_sampler, which draws predictions in O(log N). Experts whose score
+    // changed since the last sync are listed in m_changed; when there are
+    // few of them only their weights are recomputed, otherwise all weights
+    // are rebuilt with a fresh offset. m_pct_weights is derived from the
+    // same weights, so each change of the scores is exponentiated once.
+    FenwickSampler m_sampler;
+    double m_weight_offset = 0.0;
+    std::vector<size_t> m_changed;
+    bool m_weights_valid = false;
+    int m_incremental_syncs = 0;
+
+    // After set_threads(n) with n > 1 the loops over experts run on a
+    // WorkerPool, each worker on a fixed share of the experts in runs of
+    // eight, and the workers take the banks one at a time. Each expert's
+    // uniform, score and weight is the one a single thread computes, and
+    // the lists of changed experts are joined in worker order, so a seeded
+    // game plays the same on any number of threads. Only the action
+    // weights are summed per worker, and depend on the thread count.
+    struct alignas(64) WorkerState {
+        std::vector<size_t> changed, rank_changed;
+        double max = 0.0;
+        ActionWeights<A, Actions> mass;
+    };
+    std::shared_ptr<WorkerPool> m_workers;
+    std::vector<WorkerState> m_worker_state;
+    std::vector<size_t> m_bank_offsets;
 
     ExpertAdvice(LossFunction<A, Y> loss_function, int nrounds,
-                 std::vector<Expert<A, Y>> experts,
-                 std::vector<std::string> labels)
-        : loss_function{loss_function}, nrounds{nrounds}, experts{experts},
-          labels{labels}, round_counter{0}, cumulative_loss{0.0},
-          eta{std::sqrt(2.0 * std::log(experts.size()) / nrounds)} {
+                 std::vector<ExpertBank<A, Y>> banks,
+                 std::vector<std::string> labels,
+                 LossMode mode = LossMode::sampled)
+        : loss_function{loss_function}, nrounds{nrounds}, banks{banks},
+          labels{labels}, m_mode{mode}, round_counter{0},
+          cumulative_loss{0.0}, rng{random_seed()} {
 
-        auto n_experts = experts.size();
+        auto n_experts = count_experts(banks);
         advice.resize(n_experts);
+        m_uniforms.resize(n_experts);
         labels.resize(n_experts);
         scores.resize(n_experts);
 
-        m_pct_weights.resize(n_experts);
-        m_indices.resize(n_experts);
+        size_t offset = 0;
+        for (const auto &bank : this->banks) {
+            m_bank_probabilistic.push_back(bank.probabilistic());
+            m_bank_offsets.push_back(offset);
+            offset += bank.size();
+        }
+        if (m_mode == LossMode::expected) {
+            if constexpr (dense) {
+                m_probabilities.resize(n_experts * Actions::size);
+                m_action_loss.resize(Actions::size);
+            } else {
+                throw std::invalid_argument(
+                    "expected loss needs a dense action alphabet");
+            }
+        }
+
+        m_lookback = 0;
+        for (const auto &bank : this->banks) {
+            m_lookback = std::max(m_lookback, bank.lookback());
+        }
+        if (streaming() && m_lookback != SIZE_MAX) {
+            predictions.bound(m_lookback);
+            outcomes.bound(m_lookback);
+        }
 
         reset();
     }
 
+    ExpertAdvice(LossFunction<A, Y> loss_function, int nrounds,
+                 std::vector<Expert<A, Y>> experts,
+                 std::vector<std::string> labels,
+                 LossMode mode = LossMode::sampled)
+        : ExpertAdvice(loss_function, nrounds,
+                       std::vector<ExpertBank<A, Y>>{
+                           ExpertListBank<A, Y>(std::move(experts))},
+                       labels, mode) {}
+
+    void seed(uint64_t seed, uint64_t stream = 0) {
+        rng = RandomStream(seed, stream);
+    }
+
+    // Runs the loops over experts and banks on this many threads, the
+    // caller's included, from now on. Copies of the learner share them.
+    // Advice and observe take one bank per task, so a pool of a few large
+    // banks limits the speedup; PoolSpec::banks() splits the families into
+    // banks small enough to spread.
+    void set_threads(int threads) {
+        m_workers.reset();
+        m_worker_state.clear();
+        if (threads > 1) {
+            m_workers = std::make_shared<WorkerPool>(threads);
+            m_worker_state.resize(threads);
+        }
+    }
+
+    int threads() const { return m_workers ? m_workers->size() : 1; }
+
     void reset() {
         round_counter = 0;
         cumulative_loss = 0.0;
         predictions.clear();
         outcomes.clear();
+        m_horizon = streaming() ? 1.0 : nrounds;
+        eta = std::sqrt(2.0 * std::log(scores.size()) / m_horizon);
 
-        auto n_experts = experts.size();
-        for (unsigned int i = 0; i < n_experts; i++) {
-            scores[i] = 0.0;
-            advice[i] = experts[i](predictions, outcomes, round_counter);
+        std::fill(scores.begin(), scores.end(), 0.0);
+        m_changed.clear();
+        m_weights_valid = false;
+        m_stats_valid = false;
+        m_rank_changed.clear();
+        m_ranking_valid = false;
+
+        for (auto &bank : banks) {
+            bank.reset();
         }
+        advise();
+    }
 
-        update_debug();
+    bool streaming() const { return nrounds == 0; }
+    LossMode loss_mode() const { return m_mode; }
+    bool gameover() const { return !streaming() && round_counter >= nrounds; }
+    size_t lookback() const { return m_lookback; }
+
+    // Snapshots of the game so far (snapshot.h): scores, advice, history,
+    // stream position and the state of every bank. The learner it is
+    // loaded into must be built with the same banks, nrounds and loss
+    // mode; every cache is rebuilt on the next use.
+    void save(SnapshotWriter &w) const {
+        w.put(snapshot_magic);
+        w.put(snapshot_version);
+        w.put((uint64_t)sizeof(A));
+        w.put(bank_sizes());
+        w.put(nrounds);
+        w.put(round_counter);
+        w.put(cumulative_loss);
+        w.put(eta);
+        w.put(m_horizon);
+        w.put(rng);
+        w.put(scores);
+        w.put(advice);
+        save_state(w, predictions);
+        save_state(w, outcomes);
+        for (const auto &bank : banks) {
+            bank.save(w);
+        }
     }
 
-    bool gameover() const { return !(round_counter < nrounds); }
+    void load(SnapshotReader &r) {
+        if (r.get<uint64_t>() != snapshot_magic)
+            throw SnapshotError("snapshot: not a learner snapshot");
+        if (r.get<uint64_t>() != snapshot_version)
+            throw SnapshotError("snapshot: unsupported version");
+        if (r.get<uint64_t>() != sizeof(A) ||
+            r.get<std::vector<size_t>>() != bank_sizes())
+            throw SnapshotError("snapshot: different expert pool");
+        if (r.get<int>() != nrounds)
+            throw SnapshotError("snapshot: different number of rounds");
+
+        r.get(round_counter);
+        r.get(cumulative_loss);
+        r.get(eta);
+        r.get(m_horizon);
+        r.get(rng);
+        r.get(scores);
+        r.get(advice);
+        load_state(r, predictions);
+        load_state(r, outcomes);
+        for (auto &bank : banks) {
+            bank.load(r);
+        }
+        if (scores.size() != m_uniforms.size() ||
+            advice.size() != m_uniforms.size())
+            throw SnapshotError("snapshot: different expert pool");
+        if (m_mode == LossMode::expected)
+            distributions();
+
+        m_changed.clear();
+        m_weights_valid = false;
+        m_incremental_syncs = 0;
+        m_stats_valid = false;
+        m_rank_changed.clear();
+        m_ranking_valid = false;
+    }
 
     void update(A prediction, Y outcome) {
-        auto n = experts.size();
+        auto n = advice.size();
 
         outcomes.push_back(outcome);
         predictions.push_back(prediction);
         cumulative_loss += loss_function(prediction, outcome);
         round_counter++;
 
-        for (auto i = 0u; i < n; i++) {
-            scores[i] -= loss_function(advice[i], outcome);
-            advice[i] = experts[i](predictions, outcomes, round_counter);
+        if (m_mode == LossMode::expected)
+            charge_expected_loss(outcome);
+        else
+            charge_sampled_loss(outcome);
+        // Without a sync between rounds the lists would grow without bound;
+        // past N entries a rebuild is cheaper anyway.
+        if (m_changed.size() >= n) {
+            m_changed.clear();
+            m_weights_valid = false;
+        }
+        if (m_rank_changed.size() > m_rank_limit) {
+            m_rank_changed.clear();
+            m_ranking_valid = false;
+        }
+        m_stats_valid = false;
+
+        if (streaming() && round_counter >= m_horizon) {
+            m_horizon *= 2;
+            eta = std::sqrt(2.0 * std::log(n) / m_horizon);
+            m_changed.clear();
+            m_weights_valid = false;
         }
 
-        update_debug();
+        for_banks([&](size_t b) { banks[b].observe(prediction, outcome); });
+        advise();
     }
 
-    A predict() { return advice[softmax_sample(scores, eta)]; }
+    // Follows an expert drawn by weight. Under expected loss the action is
+    // then drawn from that expert's distribution.
+    A predict() {
+        sync_weights();
+        m_choice = m_sampler.find(rng() * m_sampler.total());
+        if constexpr (dense) {
+            if (m_mode == LossMode::expected)
+                return draw(m_choice, rng());
+        }
+        return advice[m_choice];
+    }
 
-  private:
+    // The expert whose advice the last predict() followed.
+    size_t last_choice() const { return m_choice; }
+
+    const std::vector<double> &pct_weights() {
+        refresh_stats();
+        return m_pct_weights;
+    }
+
+    // The k best experts, best first. Small k is answered from the
+    // tournament tree in O(k log N), after point updates for the scores
+    // that changed or a rebuild if too many did; otherwise by a partial
+    // sort.
+    const std::vector<size_t> &ranking(size_t k = SIZE_MAX) {
+        auto n = scores.size();
+        k = std::min(k, n);
+
+        if (k * 8 < n) {
+            sync_ranking();
+            m_ranking.top(k, m_indices);
+            return m_indices;
+        }
+
+        m_indices.resize(n);
+        std::iota(m_indices.begin(), m_indices.end(), 0);
+        std::partial_sort(m_indices.begin(), m_indices.begin() + k,
+                          m_indices.end(), [this](size_t a, size_t b) {
+                              if (scores[a] != scores[b])
+                                  return scores[a] > scores[b];
+                              return a < b;
+                          });
+        m_indices.resize(k);
+        return m_indices;
+    }
+
+    double action_pct_weight(const A &a) {
+        refresh_stats();
+        return m_action_pct_weights[a];
+    }
+
+    void refresh_stats() {
+        if (!m_stats_valid)
+            compute_stats();
+    }
+
+    // Computes every statistic now, including the full ranking.
     void update_debug() {
-        double M = scores[0];
-        for (unsigned i = 0; i < scores.size(); ++i) {
-            M = M >= scores[i] ? M : scores[i];
+        compute_stats();
+        ranking();
+    }
+
+  private:
+    // Gets every bank's advice for the round ahead from this round's
+    // uniforms, one per expert that samples its advice.
+    void advise() {
+        bool expected = m_mode == LossMode::expected;
+        if (expected) {
+            for (size_t b = 0; b < banks.size(); b++) {
+                if (!m_bank_probabilistic[b])
+                    rng.fill(m_uniforms.data() + m_bank_offsets[b],
+                             banks[b].size());
+            }
+        } else {
+            fill_uniforms();
         }
 
-        auto w = scores;
-        for (unsigned i = 0; i < scores.size(); ++i) {
-            w[i] = std::exp((w[i] - M) * eta);
+        for_banks([&](size_t b) {
+            auto offset = m_bank_offsets[b];
+            if (!expected || !m_bank_probabilistic[b])
+                banks[b].advise(m_uniforms.data() + offset,
+                                advice.data() + offset);
+            if (expected)
+                distribution(b);
+        });
+    }
+
+    // The round's uniforms for every expert. Workers seek to their shares
+    // of the stream, so they fill in the same numbers as one thread.
+    void fill_uniforms() {
+        auto n = m_uniforms.size();
+        if (!m_workers) {
+            rng.fill(m_uniforms.data(), n);
+            return;
+        }
+        auto start = rng.position;
+        for_shares(n, [&](size_t begin, size_t end, int) {
+            RandomStream r = rng;
+            r.seek(start + begin);
+            r.fill(m_uniforms.data() + begin, end - begin);
+        });
+        rng.seek(start + n);
+    }
+
+    void distributions() {
+        for (size_t b = 0; b < banks.size(); b++) {
+            distribution(b);
+        }
+    }
+
+    void distribution(size_t b) {
+        if constexpr (dense) {
+            constexpr size_t K = Actions::size;
+            auto offset = m_bank_offsets[b];
+            auto n = banks[b].size();
+            double *q = m_probabilities.data() + offset * K;
+            if (m_bank_probabilistic[b]) {
+                banks[b].probabilities(q, K);
+            } else {
+                std::fill(q, q + n * K, 0.0);
+                for (size_t i = 0; i < n; i++) {
+                    q[i * K + Actions::index(advice[offset + i])] = 1.0;
+                }
+            }
+        }
+    }
+
+    // Calls f(begin, end, worker) on each worker's share of n experts.
+    template <typename F> void for_shares(size_t n, F f) {
+        if (!m_workers) {
+            f(0, n, 0);
+            return;
         }
+        m_workers->run([&](int w) {
+            auto share = m_workers->share(n, w, 8);
+            f(share.first, share.second, w);
+        });
+    }
 
-        double sum = std::accumulate(w.begin(), w.end(), 0.0);
+    // Calls f(b) for every bank b.
+    template <typename F> void for_banks(F f) {
+        if (!m_workers) {
+            for (size_t b = 0; b < banks.size(); b++) {
+                f(b);
+            }
+            return;
+        }
+        std::atomic<size_t> next{0};
+        m_workers->run([&](int) {
+            for (size_t b; (b = next++) < banks.size();) {
+                f(b);
+            }
+        });
+    }
 
-        for (unsigned i = 0; i < scores.size(); ++i) {
-            w[i] = 100.0 * w[i] / sum;
+    void charge_sampled_loss(const Y &outcome) {
+        if (!m_workers) {
+            charge_sampled_loss(outcome, 0, advice.size(), m_changed,
+                                m_rank_changed);
+            return;
         }
+        for_shares(advice.size(), [&](size_t begin, size_t end, int w) {
+            auto &s = m_worker_state[w];
+            s.changed.clear();
+            s.rank_changed.clear();
+            charge_sampled_loss(outcome, begin, end, s.changed,
+                                s.rank_changed);
+        });
+        for (const auto &s : m_worker_state) {
+            m_changed.insert(m_changed.end(), s.changed.begin(),
+                             s.changed.end());
+            m_rank_changed.insert(m_rank_changed.end(),
+                                  s.rank_changed.begin(),
+                                  s.rank_changed.end());
+        }
+    }
 
-        m_pct_weights = w;
-        m_indices = sort_indexes(w);
+    void charge_sampled_loss(const Y &outcome, size_t begin, size_t end,
+                             std::vector<size_t> &changed,
+                             std::vector<size_t> &rank_changed) {
+        for (auto i = begin; i < end; i++) {
+            double loss = loss_function(advice[i], outcome);
+            if (loss != 0.0) {
+                scores[i] -= loss;
+                changed.push_back(i);
+                // One past the limit tells update() to give up on them.
+                if (m_ranking_valid && rank_changed.size() <= m_rank_limit)
+                    rank_changed.push_back(i);
+            }
+        }
+    }
 
-        m_action_pct_weights.clear();
-        for (unsigned int i = 0; i < advice.size(); i++) {
-            m_action_pct_weights[advice[i]] += w[i];
+    // Nearly every score moves by a fraction, so the weights and the
+    // ranking are rebuilt rather than updated.
+    void charge_expected_loss(const Y &outcome) {
+        if constexpr (dense) {
+            constexpr size_t K = Actions::size;
+            for (size_t a = 0; a < K; a++) {
+                m_action_loss[a] = loss_function(Actions::action(a), outcome);
+            }
+            const double *q = m_probabilities.data();
+            const double *loss = m_action_loss.data();
+            for_shares(scores.size(), [&](size_t begin, size_t end, int) {
+                for (size_t i = begin; i < end; i++) {
+                    double x = 0.0;
+                    for (size_t a = 0; a < K; a++) {
+                        x += q[i * K + a] * loss[a];
+                    }
+                    scores[i] -= x;
+                }
+            });
+            m_changed.clear();
+            m_weights_valid = false;
+            m_rank_changed.clear();
+            m_ranking_valid = false;
         }
     }
+
+    // The action of expert i for a uniform u.
+    A draw(size_t i, double u) const {
+        constexpr size_t K = Actions::size;
+        const double *q = m_probabilities.data() + i * K;
+        double c = 0.0;
+        for (size_t a = 0; a + 1 < K; a++) {
+            c += q[a];
+            if (u < c)
+                return Actions::action(a);
+        }
+        return Actions::action(K - 1);
+    }
+
+    std::vector<size_t> bank_sizes() const {
+        std::vector<size_t> sizes;
+        for (const auto &bank : banks) {
+            sizes.push_back(bank.size());
+        }
+        return sizes;
+    }
+
+    void compute_stats() {
+        sync_weights();
+        auto n = scores.size();
+        m_pct_weights.resize(n);
+        if (!m_workers) {
+            compute_stats(0, n, m_action_pct_weights);
+        } else {
+            for_shares(n, [&](size_t begin, size_t end, int w) {
+                compute_stats(begin, end, m_worker_state[w].mass);
+            });
+            m_action_pct_weights = m_worker_state[0].mass;
+            for (size_t w = 1; w < m_worker_state.size(); w++) {
+                m_action_pct_weights.add(m_worker_state[w].mass);
+            }
+        }
+        m_stats_valid = true;
+    }
+
+    void compute_stats(size_t begin, size_t end,
+                       ActionWeights<A, Actions> &mass) {
+        double *w = m_pct_weights.data() + begin;
+        double c = 100.0 / m_sampler.total();
+        for (size_t i = 0; i < end - begin; i++) {
+            w[i] = c * m_sampler.weights[begin + i];
+        }
+
+        if constexpr (dense) {
+            if (m_mode == LossMode::expected) {
+                mass.assign_probabilities(
+                    m_probabilities.data() + begin * Actions::size, w,
+                    end - begin);
+                return;
+            }
+        }
+        mass.assign(advice.data() + begin, w, end - begin);
+    }
+
+    void sync_ranking() {
+        if (m_ranking_valid) {
+            for (auto i : m_rank_changed) {
+                m_ranking.set(i, scores[i]);
+            }
+        } else {
+            auto n = scores.size();
+            m_ranking.assign(scores.data(), n);
+            m_rank_limit = (size_t)(n / (std::log2((double)n + 1.0) + 1.0));
+        }
+        m_rank_changed.clear();
+        m_ranking_valid = true;
+    }
+
+    void sync_weights() {
+        auto n = scores.size();
+        auto k = m_changed.size();
+        if (m_weights_valid && k == 0)
+            return;
+
+        // Point updates cost O(k log N) against O(N) for a rebuild. The
+        // tree is also rebuilt now and then so that rounding in the
+        // incremental sums cannot build up, and when the weights drift
+        // towards underflow.
+        double log_n = std::log2((double)n + 1.0);
+        bool incremental = m_weights_valid && k * (log_n + 1.0) < n &&
+                           m_incremental_syncs < 256;
+        if (incremental) {
+            for (auto i : m_changed) {
+                double x = (scores[i] - m_weight_offset) * eta;
+                m_sampler.set(i, std::exp(x));
+            }
+            m_incremental_syncs++;
+        }
+        if (!incremental || m_sampler.total() < 1e-100) {
+            m_sampler.weights.resize(n);
+            rebuild_weights();
+            m_sampler.rebuild();
+            m_incremental_syncs = 0;
+        }
+
+        m_changed.clear();
+        m_weights_valid = true;
+    }
+
+    // Every weight, offset by the top score.
+    void rebuild_weights() {
+        auto n = scores.size();
+        double *w = m_sampler.weights.data();
+        if (!m_workers) {
+            softmax_weights(scores.data(), n, eta, w, &m_weight_offset);
+            return;
+        }
+
+        for_shares(n, [&](size_t begin, size_t end, int k) {
+            m_worker_state[k].max =
+                begin < end ? max_score(scores.data() + begin, end - begin)
+                            : -HUGE_VAL;
+        });
+        m_weight_offset = m_worker_state[0].max;
+        for (const auto &s : m_worker_state) {
+            m_weight_offset = std::max(m_weight_offset, s.max);
+        }
+        for_shares(n, [&](size_t begin, size_t end, int) {
+            exp_weights(scores.data() + begin, end - begin, eta,
+                        m_weight_offset, w + begin);
+        });
+    }
 };
 
-double zero_one_loss(int p, int y) {
+inline double zero_one_loss(int p, int y) {
     if (p == y)
         return 0.0;
     else
         return 1.0;
 }
 
+// The built-in experts are stateful: each keeps O(1) running state that is
+// updated by observe(), instead of rescanning the history every round.
+// They play -1 when their uniform is at most some q, and their
+// probabilities() are that same q, in BinaryActions order.
+
+inline void binary_probabilities(double q, double *out) {
+    q = std::min(1.0, std::max(0.0, q));
+    out[0] = q;
+    out[1] = 1.0 - q;
+}
+
 struct ProportionExpert {
     double p;
     ProportionExpert(double p = 0.5) : p{p} {}
 
-    int operator()(const std::vector<int> &predictions,
-                   const std::vector<int> &outcomes, int n) {
-        if (runif() <= p)
+    void reset() {}
+    void observe(int /*prediction*/, int /*outcome*/) {}
+    void probabilities(double *q) { binary_probabilities(p, q); }
+
+    int operator()(double r) {
+        if (r <= p)
             return -1;
         else
             return 1;
@@ -152,13 +1208,19 @@ struct ProportionExpert {
 
 struct CorrelatedExpert {
     double p;
-    CorrelatedExpert(double p = 0.5) : p{p} {}
+    int last;
+    CorrelatedExpert(double p = 0.5) : p{p}, last{0} {}
 
-    int operator()(const std::vector<int> &predictions,
-                   const std::vector<int> &outcomes, int n) {
-        auto r = runif();
+    void reset() { last = 0; }
+    auto state() { return std::tie(last); }
+    void observe(int /*prediction*/, int outcome) { last = outcome; }
+
+    void probabilities(double *q) {
+        binary_probabilities(last == 0 ? 0.5 : last < 0 ? p : 1 - p, q);
+    }
 
-        if (outcomes.empty()) {
+    int operator()(double r) {
+        if (last == 0) {
             if (r <= 0.5)
                 return -1;
             else
@@ -166,22 +1228,28 @@ struct CorrelatedExpert {
         }
 
         if (r <= p) {
-            return outcomes.back();
+            return last;
         } else {
-            return -outcomes.back();
+            return -last;
         }
     }
 };
 
 struct StreakExpert {
     double p;
-    StreakExpert(double p = 0.5) : p{p} {}
+    int last;
+    StreakExpert(double p = 0.5) : p{p}, last{0} {}
 
-    int operator()(const std::vector<int> &predictions,
-                   const std::vector<int> &outcomes, int n) {
-        auto r = runif();
+    void reset() { last = 0; }
+    auto state() { return std::tie(last); }
+    void observe(int prediction, int outcome) { last = outcome * prediction; }
 
-        if (outcomes.empty()) {
+    void probabilities(double *q) {
+        binary_probabilities(last == 0 ? 0.5 : last < 0 ? p : 1 - p, q);
+    }
+
+    int operator()(double r) {
+        if (last == 0) {
             if (r <= 0.5)
                 return -1;
             else
@@ -189,41 +1257,46 @@ struct StreakExpert {
         }
 
         if (r <= p) {
-            return outcomes.back() * predictions.back();
+            return last;
         } else {
-            return -outcomes.back() * predictions.back();
+            return -last;
         }
     }
 };
 
 struct ExponentialExpert {
     double beta;
-    ExponentialExpert(double beta) : beta{beta} {}
+    double accum, weight;
+    ExponentialExpert(double beta) : beta{beta}, accum{0}, weight{0} {}
+
+    void reset() {
+        accum = 0;
+        weight = 0;
+    }
 
-    int operator()(const std::vector<int> &predictions,
-                   const std::vector<int> &outcomes, int n) {
-        auto r = runif();
+    auto state() { return std::tie(accum, weight); }
+
+    void observe(int /*prediction*/, int outcome) {
+        accum = accum * beta + outcome;
+        weight = weight * beta + 1;
+    }
+
+    void probabilities(double *q) {
+        binary_probabilities(weight == 0 ? 0.5 : (accum / weight + 1) / 2.0,
+                             q);
+    }
 
-        if (outcomes.empty()) {
+    int operator()(double r) {
+        if (weight == 0) {
             if (r <= 0.5)
                 return -1;
             else
                 return 1;
         }
 
-        double accum = 0;
-        double weight = 0;
-        for (auto o : outcomes) {
-            accum = accum * beta;
-            accum = accum + o;
+        double q = (accum / weight + 1) / 2.0;
 
-            weight = weight * beta;
-            weight += 1;
-        }
-        accum = accum / weight;
-        accum = (accum + 1) / 2.0;
-
-        if (r <= accum) {
+        if (r <= q) {
             return -1;
         } else {
             return 1;
@@ -231,66 +1304,109 @@ struct ExponentialExpert {
     }
 };
 
+// Rounds are whole numbers, so cos(omega t) only depends on omega modulo
+// 2 pi. Reducing it keeps omega t small, where cos and sin are accurate.
+// A period of 0 gives an infinite omega and a NaN here; such an expert has
+// no cosine to follow and advises 1 once the game has started.
+inline double reduce_frequency(double omega) {
+    return std::remainder(omega, 6.28318530717958647692);
+}
+
+// The probability of -1 from the sums of y_t cos(omega t + phi) and of the
+// cosines. When the cosines nearly cancel the ratio is mostly rounding,
+// and the expert falls back to a fair coin.
+inline double cosine_probability(double accum, double total) {
+    if (std::abs(total) < 1e-6)
+        return 0.5;
+    return (accum / total + 1) / 2.0;
+}
+
 struct CosineExpert {
     double omega, phi;
-    CosineExpert(double omega, double phi) : omega{omega}, phi{phi} {}
-
-    int operator()(const std::vector<int> &predictions,
-                   const std::vector<int> &outcomes, int n) {
-        auto r = runif();
+    double accum, total;
+    unsigned int count;
+    CosineExpert(double omega, double phi)
+        : omega{reduce_frequency(omega)}, phi{phi}, accum{0}, total{0},
+          count{0} {}
 
-        if (outcomes.empty()) {
-            if (r <= 0.5)
-                return -1;
-            else
-                return 1;
-        }
+    void reset() {
+        accum = 0;
+        total = 0;
+        count = 0;
+    }
 
-        double accum = 0;
-        double total = 0;
+    auto state() { return std::tie(accum, total, count); }
 
-        for (unsigned int i = 0; i < outcomes.size(); i++) {
-            accum += outcomes[i] * std::cos(omega * i + phi);
-            total += 1 * std::cos(omega * i + phi);
+    void observe(int /*prediction*/, int outcome) {
+        if (std::isfinite(omega)) {
+            double c = std::cos(omega * count + phi);
+            accum += outcome * c;
+            total += c;
         }
+        count++;
+    }
 
-        accum = accum / total;
-        accum = (accum + 1) / 2.0;
+    void probabilities(double *q) { binary_probabilities(probability(), q); }
 
-        if (r <= accum) {
+    int operator()(double r) {
+        if (r <= probability()) {
             return -1;
         } else {
             return 1;
         }
     }
+
+  private:
+    double probability() const {
+        if (count == 0)
+            return 0.5;
+        if (!std::isfinite(omega))
+            return 0.0;
+        return cosine_probability(accum, total);
+    }
 };
 
 struct LengthTwoExpert {
     double a, b, c, d;
+    int x, y;
     LengthTwoExpert(double a, double b, double c, double d)
-        : a{a}, b{b}, c{c}, d{d} {}
+        : a{a}, b{b}, c{c}, d{d}, x{0}, y{0} {}
 
-    int operator()(const std::vector<int> &predictions,
-                   const std::vector<int> &outcomes, int n) {
-        auto r = runif();
+    void reset() {
+        x = 0;
+        y = 0;
+    }
+
+    auto state() { return std::tie(x, y); }
+
+    void observe(int /*prediction*/, int outcome) {
+        x = y;
+        y = outcome;
+    }
 
-        if (outcomes.size() <= 1) {
+    void probabilities(double *q) {
+        if (x == 0)
+            binary_probabilities(0.5, q);
+        else if (x == -1)
+            binary_probabilities(y == -1 ? a : b, q);
+        else
+            binary_probabilities(y == -1 ? c : d, q);
+    }
+
+    int operator()(double r) {
+        if (x == 0) {
             if (r <= 0.5)
                 return -1;
             else
                 return 1;
         }
 
-        int x = outcomes[outcomes.size() - 2];
-        int y = outcomes[outcomes.size() - 1];
-
         if (x == -1 && y == -1)
             return (r <= a) ? -1 : 1;
         if (x == -1 && y == 1)
             return (r <= b) ? -1 : 1;
         if (x == 1 && y == -1)
             return (r <= c) ? -1 : 1;
-        if (x == 1 && y == 1)
-            return (r <= d) ? -1 : 1;
+        return (r <= d) ? -1 : 1;
     }
 };
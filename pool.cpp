@@ -0,0 +1,352 @@
+#include "pool.h"
+#include "banks.h"
+#include "ctw.h"
+#include "lib/fmt/include/fmt/format.h"
+#include "pattern.h"
+#include "rng.h"
+#include "suffix.h"
+#include <algorithm>
+#include <stdexcept>
+
+#define PI 3.14159265358979323846
+
+// The grids of the GUI pool.
+static std::vector<double> default_grid() {
+    std::vector<double> grid;
+    for (double x = 0.0; x <= 1; x += 0.05) {
+        grid.push_back(x);
+    }
+    return grid;
+}
+
+static const std::vector<double> grid2 = {0.1, 0.25, 0.4, 0.6, 0.75, 0.9};
+static const std::vector<double> grid3 = {0.1, 0.3, 0.5, 0.7, 0.9};
+static const std::vector<double> betas = {0.9,  0.85, 0.8,  0.75, 0.7,
+                                          0.65, 0.6,  0.55, 0.5};
+static const std::vector<double> omegas = {0.0, 0.5, 1.0, 1.5, 2.,
+                                           2.5, 3.,  3.5, 4.,  4.5,
+                                           5.,  5.5, 6.};
+static const std::vector<double> phis = {-PI, -0.5 * PI, 0., 0.5 * PI, PI};
+
+static void set_cosine(PoolSpec &spec, const std::vector<double> &periods,
+                       const std::vector<double> &phases) {
+    spec.cosine_omega.clear();
+    spec.cosine_phi.clear();
+    for (auto w : periods) {
+        for (auto phi : phases) {
+            spec.cosine_omega.push_back(2 * PI / w);
+            spec.cosine_phi.push_back(phi);
+        }
+    }
+}
+
+static void set_length_two(PoolSpec &spec, const std::vector<double> &grid) {
+    for (auto &column : spec.length_two) {
+        column.clear();
+    }
+    for (auto a : grid) {
+        for (auto b : grid) {
+            for (auto c : grid) {
+                for (auto d : grid) {
+                    spec.length_two[0].push_back(a);
+                    spec.length_two[1].push_back(b);
+                    spec.length_two[2].push_back(c);
+                    spec.length_two[3].push_back(d);
+                }
+            }
+        }
+    }
+}
+
+PoolSpec PoolSpec::defaults() {
+    PoolSpec spec;
+    spec.proportion = default_grid();
+    spec.exponential = betas;
+    spec.streak = grid2;
+    spec.correlated = grid2;
+    set_cosine(spec, omegas, phis);
+    set_length_two(spec, grid3);
+    return spec;
+}
+
+// "0.1,0.5,0.9" or "0:1:0.25" or a mix of both; empty is an empty list.
+static std::vector<double> parse_values(const std::string &list) {
+    std::vector<double> values;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        auto comma = std::min(list.find(',', pos), list.size());
+        auto item = list.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        auto colon = item.find(':');
+        if (colon == std::string::npos) {
+            values.push_back(std::stod(item));
+            continue;
+        }
+        auto colon2 = item.find(':', colon + 1);
+        if (colon2 == std::string::npos)
+            throw std::invalid_argument("range needs LO:HI:STEP: " + item);
+        double lo = std::stod(item.substr(0, colon));
+        double hi = std::stod(item.substr(colon + 1, colon2 - colon - 1));
+        double step = std::stod(item.substr(colon2 + 1));
+        if (!(step > 0.0) || hi < lo)
+            throw std::invalid_argument("bad range: " + item);
+        for (long i = 0; lo + i * step <= hi + 1e-9 * step; i++) {
+            values.push_back(lo + i * step);
+        }
+    }
+    return values;
+}
+
+PoolSpec PoolSpec::parse(const std::string &text) {
+    PoolSpec spec = defaults();
+    if (text == "defaults")
+        return spec;
+
+    std::vector<double> periods = omegas, phases = phis;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        auto semi = std::min(text.find(';', pos), text.size());
+        auto item = text.substr(pos, semi - pos);
+        pos = semi + 1;
+        if (item.empty())
+            continue;
+
+        auto eq = item.find('=');
+        if (eq == std::string::npos)
+            throw std::invalid_argument("expected family=values: " + item);
+        auto family = item.substr(0, eq);
+        auto values = parse_values(item.substr(eq + 1));
+
+        if (family == "proportion")
+            spec.proportion = values;
+        else if (family == "exponential")
+            spec.exponential = values;
+        else if (family == "streak")
+            spec.streak = values;
+        else if (family == "correlated")
+            spec.correlated = values;
+        else if (family == "cosine")
+            periods = values;
+        else if (family == "phase")
+            phases = values;
+        else if (family == "length_two")
+            set_length_two(spec, values);
+        else if (family == "context_tree")
+            spec.context_tree.assign(values.begin(), values.end());
+        else if (family == "suffix_match")
+            spec.suffix_match = values;
+        else if (family == "window")
+            spec.window.assign(values.begin(), values.end());
+        else if (family == "run")
+            spec.run.assign(values.begin(), values.end());
+        else
+            throw std::invalid_argument("unknown family: " + family);
+    }
+    set_cosine(spec, periods, phases);
+
+    if (spec.size() == 0)
+        throw std::invalid_argument("empty pool: " + text);
+    return spec;
+}
+
+PoolSpec PoolSpec::random(size_t n, uint64_t seed) {
+    RandomStream rng(seed);
+    PoolSpec spec;
+
+    for (size_t i = 0; i < n; i++) {
+        switch (i % 10) {
+        case 0:
+            spec.proportion.push_back(rng());
+            break;
+        case 1:
+            spec.exponential.push_back(rng());
+            break;
+        case 2:
+            spec.streak.push_back(rng());
+            break;
+        case 3:
+            spec.correlated.push_back(rng());
+            break;
+        case 4:
+            spec.cosine_omega.push_back(2 * PI / (6 * rng()));
+            spec.cosine_phi.push_back(2 * PI * rng() - PI);
+            break;
+        case 5:
+            for (auto &column : spec.length_two) {
+                column.push_back(rng());
+            }
+            break;
+        case 6:
+            spec.context_tree.push_back((int)(12 * rng()));
+            break;
+        case 7:
+            spec.suffix_match.push_back(rng());
+            break;
+        case 8:
+            spec.window.push_back(1 + (int)(100 * rng()));
+            break;
+        case 9:
+            spec.run.push_back(1 + (int)(8 * rng()));
+            break;
+        }
+    }
+
+    return spec;
+}
+
+size_t PoolSpec::size() const {
+    return proportion.size() + exponential.size() + streak.size() +
+           correlated.size() + cosine_omega.size() + length_two[0].size() +
+           context_tree.size() + suffix_match.size() + window.size() +
+           run.size();
+}
+
+std::vector<std::string> PoolSpec::labels() const {
+    std::vector<std::string> labels;
+
+    for (auto g : proportion) {
+        labels.push_back(fmt::format("Proportion[{:.2f}]", g));
+    }
+    for (auto g : exponential) {
+        labels.push_back(fmt::format("Exponential[{:.2f}]", g));
+    }
+    for (auto g : streak) {
+        labels.push_back(fmt::format("Streak[{:.2f}]", g));
+    }
+    for (auto g : correlated) {
+        labels.push_back(fmt::format("Correlated[{:.2f}]", g));
+    }
+    for (size_t i = 0; i < cosine_omega.size(); i++) {
+        labels.push_back(fmt::format("Cosine[{:.2f} {:.2f}]",
+                                     2 * PI / cosine_omega[i],
+                                     cosine_phi[i]));
+    }
+    for (size_t i = 0; i < length_two[0].size(); i++) {
+        labels.push_back(fmt::format(
+            "LengthTwo[{:.2f} {:.2f} {:.2f} {:.2f}]", length_two[0][i],
+            length_two[1][i], length_two[2][i], length_two[3][i]));
+    }
+    for (auto d : context_tree) {
+        labels.push_back(fmt::format("ContextTree[{}]", d));
+    }
+    for (auto p : suffix_match) {
+        labels.push_back(fmt::format("SuffixMatch[{:.2f}]", p));
+    }
+    for (auto k : window) {
+        labels.push_back(fmt::format("Window[{}]", k));
+    }
+    for (auto r : run) {
+        labels.push_back(fmt::format("Run[{}]", r));
+    }
+
+    return labels;
+}
+
+// Up to n items of v from begin.
+template <typename T>
+static std::vector<T> slice(const std::vector<T> &v, size_t begin, size_t n) {
+    auto end = begin + std::min(n, v.size() - begin);
+    return std::vector<T>(v.begin() + begin, v.begin() + end);
+}
+
+std::vector<ExpertBank<int, int>> PoolSpec::banks(size_t chunk) const {
+    std::vector<ExpertBank<int, int>> banks;
+    if (chunk == 0)
+        chunk = std::max<size_t>(256, size() / 64);
+
+    for (size_t i = 0; i < proportion.size(); i += chunk)
+        banks.push_back(ProportionBank(slice(proportion, i, chunk)));
+    for (size_t i = 0; i < exponential.size(); i += chunk)
+        banks.push_back(ExponentialBank(slice(exponential, i, chunk)));
+    for (size_t i = 0; i < streak.size(); i += chunk)
+        banks.push_back(StreakBank(slice(streak, i, chunk)));
+    for (size_t i = 0; i < correlated.size(); i += chunk)
+        banks.push_back(CorrelatedBank(slice(correlated, i, chunk)));
+    for (size_t i = 0; i < cosine_omega.size(); i += chunk)
+        banks.push_back(CosineBank(slice(cosine_omega, i, chunk),
+                                   slice(cosine_phi, i, chunk)));
+    for (size_t i = 0; i < length_two[0].size(); i += chunk)
+        banks.push_back(LengthTwoBank(slice(length_two[0], i, chunk),
+                                      slice(length_two[1], i, chunk),
+                                      slice(length_two[2], i, chunk),
+                                      slice(length_two[3], i, chunk)));
+    for (size_t i = 0; i < context_tree.size(); i += chunk)
+        banks.push_back(ContextTreeBank(slice(context_tree, i, chunk)));
+    for (size_t i = 0; i < suffix_match.size(); i += chunk)
+        banks.push_back(SuffixMatchBank(slice(suffix_match, i, chunk)));
+    for (size_t i = 0; i < window.size(); i += chunk)
+        banks.push_back(WindowBank(slice(window, i, chunk)));
+    for (size_t i = 0; i < run.size(); i += chunk)
+        banks.push_back(RunBank(slice(run, i, chunk)));
+
+    return banks;
+}
+
+std::vector<ExpertBank<int, int>> PoolSpec::static_banks() const {
+    return {StaticBank<ProportionBank, ExponentialBank, StreakBank,
+                       CorrelatedBank, CosineBank, LengthTwoBank,
+                       ContextTreeBank, SuffixMatchBank, WindowBank,
+                       RunBank>(
+        ProportionBank(proportion), ExponentialBank(exponential),
+        StreakBank(streak), CorrelatedBank(correlated),
+        CosineBank(cosine_omega, cosine_phi),
+        LengthTwoBank(length_two[0], length_two[1], length_two[2],
+                      length_two[3]),
+        ContextTreeBank(context_tree), SuffixMatchBank(suffix_match),
+        WindowBank(window), RunBank(run))};
+}
+
+std::vector<Expert<int, int>> PoolSpec::experts() const {
+    std::vector<Expert<int, int>> experts;
+
+    for (auto g : proportion) {
+        experts.push_back(ProportionExpert(g));
+    }
+    for (auto g : exponential) {
+        experts.push_back(ExponentialExpert(g));
+    }
+    for (auto g : streak) {
+        experts.push_back(StreakExpert(g));
+    }
+    for (auto g : correlated) {
+        experts.push_back(CorrelatedExpert(g));
+    }
+    for (size_t i = 0; i < cosine_omega.size(); i++) {
+        experts.push_back(CosineExpert(cosine_omega[i], cosine_phi[i]));
+    }
+    for (size_t i = 0; i < length_two[0].size(); i++) {
+        experts.push_back(LengthTwoExpert(length_two[0][i], length_two[1][i],
+                                          length_two[2][i],
+                                          length_two[3][i]));
+    }
+    for (auto d : context_tree) {
+        experts.push_back(ContextTreeExpert(d));
+    }
+    for (auto p : suffix_match) {
+        experts.push_back(SuffixMatchExpert(p));
+    }
+    for (auto k : window) {
+        experts.push_back(WindowExpert(k));
+    }
+    for (auto r : run) {
+        experts.push_back(RunExpert(r));
+    }
+
+    return experts;
+}
+
+ExpertPool default_pool() {
+    auto spec = PoolSpec::defaults();
+    return {spec.banks(), spec.labels()};
+}
+
+ExpertPool default_scalar_pool() {
+    auto spec = PoolSpec::defaults();
+    return {{ExpertListBank<int, int>(spec.experts())}, spec.labels()};
+}
+
+ExpertPool random_pool(size_t n, uint64_t seed) {
+    auto spec = PoolSpec::random(n, seed);
+    return {spec.banks(), spec.labels()};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "pennies.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Parameters of a pool of built-in experts, grouped by family. The same
+// spec can be built as banks of each family or as a list of individually
+// called experts; both give the same advice from the same uniforms.
+struct PoolSpec {
+    std::vector<double> proportion;
+    std::vector<double> exponential;
+    std::vector<double> streak;
+    std::vector<double> correlated;
+    std::vector<double> cosine_omega, cosine_phi;
+    std::vector<double> length_two[4];
+    std::vector<int> context_tree; // depths
+    std::vector<double> suffix_match;
+    std::vector<int> window, run; // lengths
+
+    // The pool played by the mindreader GUI.
+    static PoolSpec defaults();
+
+    // The defaults with some families replaced, from a spec such as
+    //
+    //     proportion=0:1:0.1;cosine=2,3,4;length_two=0.1,0.5,0.9
+    //
+    // Each family takes a list of numbers and LO:HI:STEP ranges; an empty
+    // list drops it. cosine lists periods and phase phases, and each
+    // period is played with each phase; length_two is one grid used for
+    // all four parameters; context_tree lists depths, suffix_match
+    // thresholds, and window and run lengths, and these four are empty in
+    // the defaults. "defaults" alone is the GUI pool. Throws
+    // std::invalid_argument for a malformed spec.
+    static PoolSpec parse(const std::string &spec);
+
+    // n experts spread evenly over the families with random parameters,
+    // for benchmarks and tests at other sizes.
+    static PoolSpec random(size_t n, uint64_t seed);
+
+    size_t size() const;
+    std::vector<std::string> labels() const;
+    // Each family split into banks of at most chunk experts. A learner
+    // runs each bank on one thread, so the default, chunk 0, keeps banks
+    // to the larger of 256 experts and N / 64, which leaves every thread
+    // of set_threads() several; SIZE_MAX gives one bank per family.
+    std::vector<ExpertBank<int, int>> banks(size_t chunk = 0) const;
+    // The same banks compiled into one StaticBank.
+    std::vector<ExpertBank<int, int>> static_banks() const;
+    std::vector<Expert<int, int>> experts() const;
+};
+
+struct ExpertPool {
+    std::vector<ExpertBank<int, int>> banks;
+    std::vector<std::string> labels;
+};
+
+// The expert pool played by the mindreader GUI, as PoolSpec::banks().
+ExpertPool default_pool();
+
+// The same pool as a list of individually called experts. It gives the same
+// advice as default_pool() and is kept as a reference implementation.
+ExpertPool default_scalar_pool();
+
+// PoolSpec::random(n, seed) as banks.
+ExpertPool random_pool(size_t n, uint64_t seed);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// A tournament tree over a vector of values: every internal node holds the
+// index of the largest value below it. Building is O(N), changing one value
+// is O(log N), and the K largest values come out best-first in
+// O(K log N) without touching the rest of the tree. Ties go to the lower
+// index.
+struct TournamentTree {
+    std::vector<double> values;
+    std::vector<size_t> tree; // tree[1] is the root, leaves start at `leaves`
+    size_t leaves = 1;
+    std::vector<size_t> frontier; // scratch heap for top()
+
+    size_t size() const { return values.size(); }
+
+    void assign(const double *v, size_t n) {
+        values.assign(v, v + n);
+        leaves = 1;
+        while (leaves < n) {
+            leaves *= 2;
+        }
+        tree.assign(2 * leaves, n);
+        for (size_t i = 0; i < n; i++) {
+            tree[leaves + i] = i;
+        }
+        for (size_t node = leaves - 1; node >= 1; node--) {
+            tree[node] = winner(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    void set(size_t i, double v) {
+        values[i] = v;
+        for (size_t node = (leaves + i) / 2; node >= 1; node /= 2) {
+            tree[node] = winner(tree[2 * node], tree[2 * node + 1]);
+        }
+    }
+
+    // Writes the indices of the k largest values, largest first. Each
+    // frontier node is a subtree not yet reported; popping one reports its
+    // winner and pushes the subtrees that lost along the winner's path.
+    void top(size_t k, std::vector<size_t> &out) {
+        out.clear();
+        k = std::min(k, size());
+        auto worse = [this](size_t a, size_t b) {
+            return winner(tree[a], tree[b]) == tree[b];
+        };
+        frontier.clear();
+        if (k > 0)
+            frontier.push_back(1);
+        while (out.size() < k) {
+            std::pop_heap(frontier.begin(), frontier.end(), worse);
+            size_t node = frontier.back();
+            frontier.pop_back();
+            out.push_back(tree[node]);
+            while (node < leaves) {
+                size_t left = 2 * node, right = left + 1;
+                size_t loser = tree[left] == tree[node] ? right : left;
+                if (tree[loser] != size()) {
+                    frontier.push_back(loser);
+                    std::push_heap(frontier.begin(), frontier.end(), worse);
+                }
+                node = left + right - loser;
+            }
+        }
+    }
+
+  private:
+    // Padding leaves hold size(), which loses to every real index.
+    size_t winner(size_t a, size_t b) const {
+        if (b == size())
+            return a;
+        if (a == size())
+            return b;
+        if (values[a] != values[b])
+            return values[a] > values[b] ? a : b;
+        return std::min(a, b);
+    }
+};
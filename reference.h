@@ -0,0 +1,182 @@
+#pragma once
+
+#include "pennies.h"
+#include "rng.h"
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// The learner as originally written, kept as plain as possible: every
+// expert is called on its own, weights are exponentiated with std::exp,
+// predictions come from a linear scan and the ranking from a full sort.
+// It consumes its RandomStream in the same order as ExpertAdvice, so the
+// two make the same choices and optimized engines can be checked against
+// it. Under LossMode::expected every expert must be probabilistic.
+template <typename A, typename Y, typename Actions = BinaryActions>
+struct ReferenceAdvice {
+    std::vector<A> predictions;
+    std::vector<Y> outcomes;
+    std::vector<A> advice;
+
+    LossFunction<A, Y> loss_function;
+    const int nrounds;
+    const double eta;
+    const LossMode mode;
+    std::vector<std::vector<double>> probabilities;
+
+    std::vector<double> scores;
+    std::vector<Expert<A, Y>> experts;
+
+    std::vector<double> m_pct_weights;
+    std::vector<size_t> m_indices;
+    std::map<A, double> m_action_pct_weights;
+
+    int round_counter;
+    double cumulative_loss;
+
+    RandomStream rng;
+    std::vector<double> m_uniforms;
+
+    ReferenceAdvice(LossFunction<A, Y> loss_function, int nrounds,
+                    std::vector<Expert<A, Y>> experts,
+                    LossMode mode = LossMode::sampled)
+        : loss_function{loss_function}, nrounds{nrounds},
+          eta{std::sqrt(2.0 * std::log(experts.size()) / nrounds)},
+          mode{mode}, experts{experts}, round_counter{0},
+          cumulative_loss{0.0} {
+        auto n = this->experts.size();
+        advice.resize(n);
+        probabilities.assign(n, std::vector<double>(Actions::size));
+        scores.resize(n);
+        m_pct_weights.resize(n);
+        m_uniforms.resize(n);
+        reset();
+    }
+
+    void seed(uint64_t seed, uint64_t stream = 0) {
+        rng = RandomStream(seed, stream);
+    }
+
+    void reset() {
+        round_counter = 0;
+        cumulative_loss = 0.0;
+        predictions.clear();
+        outcomes.clear();
+
+        for (size_t i = 0; i < experts.size(); i++) {
+            scores[i] = 0.0;
+            experts[i].reset();
+        }
+        advise();
+
+        update_debug();
+    }
+
+    bool gameover() const { return !(round_counter < nrounds); }
+
+    void update(A prediction, Y outcome) {
+        outcomes.push_back(outcome);
+        predictions.push_back(prediction);
+        cumulative_loss += loss_function(prediction, outcome);
+        round_counter++;
+
+        for (size_t i = 0; i < experts.size(); i++) {
+            scores[i] -= loss(i, outcome);
+            experts[i].observe(prediction, outcome);
+        }
+        advise();
+
+        update_debug();
+    }
+
+    A predict() {
+        auto w = weights();
+        double sum = std::accumulate(w.begin(), w.end(), 0.0);
+        double u = rng() * sum;
+
+        double accum = 0.0;
+        size_t choice = w.size() - 1;
+        for (size_t i = 0; i < w.size(); i++) {
+            accum += w[i];
+            if (u <= accum) {
+                choice = i;
+                break;
+            }
+        }
+        if (mode == LossMode::sampled)
+            return advice[choice];
+
+        u = rng();
+        accum = 0.0;
+        for (size_t a = 0; a + 1 < Actions::size; a++) {
+            accum += probabilities[choice][a];
+            if (u < accum)
+                return Actions::action(a);
+        }
+        return Actions::action(Actions::size - 1);
+    }
+
+    void update_debug() {
+        auto w = weights();
+        double sum = std::accumulate(w.begin(), w.end(), 0.0);
+        for (size_t i = 0; i < w.size(); i++) {
+            w[i] = 100.0 * w[i] / sum;
+        }
+
+        m_pct_weights = w;
+        m_indices = sort_indexes(w);
+
+        m_action_pct_weights.clear();
+        for (size_t i = 0; i < advice.size(); i++) {
+            if (mode == LossMode::sampled) {
+                m_action_pct_weights[advice[i]] += w[i];
+                continue;
+            }
+            for (size_t a = 0; a < Actions::size; a++) {
+                m_action_pct_weights[Actions::action(a)] +=
+                    w[i] * probabilities[i][a];
+            }
+        }
+    }
+
+  private:
+    void advise() {
+        if (mode == LossMode::expected) {
+            for (size_t i = 0; i < experts.size(); i++) {
+                experts[i].probabilities(probabilities[i].data());
+            }
+            return;
+        }
+        rng.fill(m_uniforms.data(), m_uniforms.size());
+        for (size_t i = 0; i < experts.size(); i++) {
+            advice[i] = experts[i](predictions, outcomes, round_counter,
+                                   m_uniforms[i]);
+        }
+    }
+
+    double loss(size_t i, const Y &outcome) {
+        if (mode == LossMode::sampled)
+            return loss_function(advice[i], outcome);
+        double x = 0.0;
+        for (size_t a = 0; a < Actions::size; a++) {
+            x += probabilities[i][a] *
+                 loss_function(Actions::action(a), outcome);
+        }
+        return x;
+    }
+
+    std::vector<double> weights() const {
+        double M = scores[0];
+        for (auto s : scores) {
+            M = M >= s ? M : s;
+        }
+
+        std::vector<double> w(scores.size());
+        for (size_t i = 0; i < scores.size(); i++) {
+            w[i] = std::exp((scores[i] - M) * eta);
+        }
+        return w;
+    }
+};
@@ -0,0 +1,188 @@
+#include "lib/fmt/include/fmt/format.h"
+#include "gamelog.h"
+#include "pennies.h"
+#include "pool.h"
+#include "rng.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Replays recorded games against an expert pool: the human's recorded
+// moves are fed to a fresh learner, and its losses are compared with those
+// of the machine that played the game.
+
+struct ReplayOptions {
+    std::vector<std::string> logs;
+    std::string pool = "default";
+    int rounds = 101;
+    int threads = 0;
+    uint64_t seed = 1;
+};
+
+struct ReplayStats {
+    long games = 0;
+    long rounds = 0;
+    double recorded_loss = 0.0; // the machine that played the game
+    double loss = 0.0;          // the replayed learner's predictions
+    double expected_loss = 0.0; // its weight on the wrong move
+
+    void merge(const ReplayStats &s) {
+        games += s.games;
+        rounds += s.rounds;
+        recorded_loss += s.recorded_loss;
+        loss += s.loss;
+        expected_loss += s.expected_loss;
+    }
+};
+
+// default, or random:N[:SEED]
+static ExpertPool make_pool(const std::string &spec) {
+    if (spec == "default")
+        return default_pool();
+    if (spec.rfind("random:", 0) == 0) {
+        auto colon = spec.find(':', 7);
+        size_t n = std::stoul(spec.substr(7, colon - 7));
+        uint64_t seed = 1;
+        if (colon != std::string::npos)
+            seed = std::stoull(spec.substr(colon + 1));
+        return random_pool(n, seed);
+    }
+    throw std::invalid_argument("unknown pool: " + spec);
+}
+
+static void usage() {
+    fmt::print(stderr,
+               "usage: mindreader-replay [--pool default|random:N[:SEED]]\n"
+               "                         [--rounds R] [--threads T] "
+               "[--seed S] LOG...\n");
+}
+
+static ReplayOptions parse_options(int argc, char **argv) {
+    ReplayOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (arg.rfind("--", 0) != 0) {
+            opts.logs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--pool")
+            opts.pool = value;
+        else if (arg == "--rounds")
+            opts.rounds = std::stoi(value);
+        else if (arg == "--threads")
+            opts.threads = std::stoi(value);
+        else if (arg == "--seed")
+            opts.seed = std::stoull(value);
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+
+    if (opts.logs.empty())
+        throw std::invalid_argument("no game logs given");
+    if (opts.rounds <= 0)
+        throw std::invalid_argument("rounds must be positive");
+    if (opts.threads <= 0)
+        opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    return opts;
+}
+
+int main(int argc, char **argv) {
+    ReplayOptions opts;
+    ExpertPool pool;
+    std::vector<std::unique_ptr<GameLog>> logs;
+    std::vector<const GameView *> games;
+    try {
+        opts = parse_options(argc, argv);
+        pool = make_pool(opts.pool);
+        for (const auto &path : opts.logs) {
+            logs.push_back(std::make_unique<GameLog>(path));
+            for (const auto &g : logs.back()->games) {
+                games.push_back(&g);
+            }
+        }
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-replay: {}\n", e.what());
+        usage();
+        return 1;
+    }
+
+    const long batch = 16;
+    std::atomic<long> next_game{0};
+    std::vector<ReplayStats> stats(opts.threads);
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int t = 0; t < opts.threads; t++) {
+        workers.emplace_back([&, t] {
+            auto E = ExpertAdvice<int, int, BinaryActions>(
+                zero_one_loss, opts.rounds, pool.banks, pool.labels);
+            long n = (long)games.size();
+
+            while (true) {
+                long first = next_game.fetch_add(batch);
+                if (first >= n)
+                    break;
+                for (long g = first; g < std::min(first + batch, n); g++) {
+                    const auto &game = *games[g];
+                    auto rounds = std::min<size_t>(game.rounds, opts.rounds);
+                    auto &s = stats[t];
+
+                    E.seed(opts.seed, g);
+                    E.reset();
+                    for (size_t i = 0; i < rounds; i++) {
+                        int y = game.outcome(i);
+                        int p = E.predict();
+                        s.recorded_loss += game.prediction(i) != y;
+                        s.loss += p != y;
+                        s.expected_loss += E.action_pct_weight(-y) / 100.0;
+                        E.update(p, y);
+                    }
+                    s.games++;
+                    s.rounds += rounds;
+                }
+            }
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+
+    ReplayStats total;
+    for (const auto &s : stats) {
+        total.merge(s);
+    }
+    double r = std::max(1.0, (double)total.rounds);
+
+    fmt::print("pool            {} ({} experts)\n", opts.pool,
+               pool.labels.size());
+    fmt::print("logs            {}\n", opts.logs.size());
+    fmt::print("games           {}\n", total.games);
+    fmt::print("rounds          {}\n", total.rounds);
+    fmt::print("threads         {}\n", opts.threads);
+    fmt::print("seconds         {:.3f}\n", seconds);
+    fmt::print("games/sec       {:.1f}\n", total.games / seconds);
+    fmt::print("recorded loss   {:.4f}\n", total.recorded_loss / r);
+    fmt::print("replay loss     {:.4f}\n", total.loss / r);
+    fmt::print("expected loss   {:.4f}\n", total.expected_loss / r);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+// Counter-based random numbers (Philox4x32-10, Salmon et al. 2011).
+//
+// A RandomStream is addressed by (seed, stream, position): the uniform at a
+// given position is a pure function of the three, so streams need no shared
+// state, can be copied to replay a game, and can jump to any position in
+// O(1). Different stream ids give independent sequences for the same seed;
+// use them for games, threads or expert families.
+struct RandomStream {
+    uint64_t key = 0;
+    uint64_t stream = 0;
+    uint64_t position = 0;
+
+    RandomStream() = default;
+    RandomStream(uint64_t seed, uint64_t stream = 0)
+        : key{mix(seed)}, stream{stream}, position{0} {}
+
+    // The next uniform in [0, 1).
+    double operator()() {
+        uint64_t out[2];
+        block(position / 2, out);
+        return to_unit(out[position++ % 2]);
+    }
+
+    // Writes the next n uniforms to u.
+    void fill(double *u, size_t n) {
+        size_t i = 0;
+        if (position % 2 == 1 && n > 0) {
+            u[i++] = (*this)();
+        }
+        uint64_t out[2];
+        for (; i + 2 <= n; i += 2) {
+            block(position / 2, out);
+            u[i] = to_unit(out[0]);
+            u[i + 1] = to_unit(out[1]);
+            position += 2;
+        }
+        if (i < n) {
+            u[i] = (*this)();
+        }
+    }
+
+    void seek(uint64_t p) { position = p; }
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+  private:
+    static double to_unit(uint64_t x) { return (x >> 11) * 0x1.0p-53; }
+
+    static void mulhilo(uint32_t a, uint32_t b, uint32_t &hi, uint32_t &lo) {
+        uint64_t p = (uint64_t)a * b;
+        hi = (uint32_t)(p >> 32);
+        lo = (uint32_t)p;
+    }
+
+    // Philox4x32-10 of the counter (index, stream) under key.
+    void block(uint64_t index, uint64_t out[2]) const {
+        uint32_t c0 = (uint32_t)index, c1 = (uint32_t)(index >> 32);
+        uint32_t c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+        uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+
+        for (int r = 0; r < 10; r++) {
+            uint32_t hi0, lo0, hi1, lo1;
+            mulhilo(0xD2511F53u, c0, hi0, lo0);
+            mulhilo(0xCD9E8D57u, c2, hi1, lo1);
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+
+        out[0] = (uint64_t)c0 << 32 | c1;
+        out[1] = (uint64_t)c2 << 32 | c3;
+    }
+};
+
+// A seed drawn from std::random_device, for runs that need not replay.
+inline uint64_t random_seed() {
+    std::random_device rd;
+    return (uint64_t)rd() << 32 | rd();
+}
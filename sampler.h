@@ -0,0 +1,68 @@
+#pragma once
+
+#include "util.h"
+#include <cstddef>
+#include <vector>
+
+// Weighted sampling over a Fenwick tree of non-negative weights. Building
+// from scratch is O(N); changing one weight, drawing an index and reading
+// the total are O(log N).
+//
+// Draws agree with sample() in util.cpp: for the same uniform, find()
+// returns the first index whose prefix sum reaches u * total().
+struct FenwickSampler {
+    std::vector<double> weights;
+    std::vector<double> tree; // 1-based partial sums
+    size_t top = 0;           // largest power of two <= size()
+    double sum = 0.0;
+
+    size_t size() const { return weights.size(); }
+    double total() const { return sum; }
+
+    void assign(const double *w, size_t n) {
+        weights.assign(w, w + n);
+        rebuild();
+    }
+
+    // Rebuilds the tree after the weights were written directly.
+    void rebuild() {
+        size_t n = weights.size();
+        tree.assign(n + 1, 0.0);
+        sum = 0.0;
+        for (size_t i = 1; i <= n; i++) {
+            tree[i] += weights[i - 1];
+            sum += weights[i - 1];
+            size_t j = i + (i & (~i + 1));
+            if (j <= n)
+                tree[j] += tree[i];
+        }
+        top = 1;
+        while (top * 2 <= n) {
+            top *= 2;
+        }
+    }
+
+    void set(size_t i, double w) {
+        double delta = w - weights[i];
+        weights[i] = w;
+        sum += delta;
+        for (size_t j = i + 1; j < tree.size(); j += j & (~j + 1)) {
+            tree[j] += delta;
+        }
+    }
+
+    // The first index i with w[0] + ... + w[i] >= u.
+    size_t find(double u) const {
+        size_t pos = 0;
+        for (size_t step = top; step > 0; step /= 2) {
+            size_t next = pos + step;
+            if (next < tree.size() && tree[next] < u) {
+                pos = next;
+                u -= tree[next];
+            }
+        }
+        return pos < size() ? pos : size() - 1;
+    }
+
+    size_t sample() const { return find(runif() * sum); }
+};
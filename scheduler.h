@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Runs f(task, worker) for every task in [0, n) on the given number of
+// threads. Each worker starts with an equal run of consecutive tasks and
+// takes them from the front. A worker that runs out steals the back half of
+// the longest run left, so uneven tasks never leave a thread idle while
+// others have work queued, and neighbouring tasks mostly share a thread.
+template <typename F> void parallel_for(size_t n, int threads, F f) {
+    struct Run {
+        std::mutex mutex;
+        size_t begin = 0, end = 0;
+    };
+    std::vector<Run> runs(threads);
+    for (int w = 0; w < threads; w++) {
+        runs[w].begin = n * w / threads;
+        runs[w].end = n * (w + 1) / threads;
+    }
+
+    auto take = [&](int w, size_t &task) {
+        std::lock_guard<std::mutex> lock(runs[w].mutex);
+        if (runs[w].begin == runs[w].end)
+            return false;
+        task = runs[w].begin++;
+        return true;
+    };
+
+    // Moves the back half of the longest other run to worker w's run.
+    auto steal = [&](int w) {
+        while (true) {
+            int victim = -1;
+            size_t longest = 0;
+            for (int v = 0; v < threads; v++) {
+                if (v == w)
+                    continue;
+                std::lock_guard<std::mutex> lock(runs[v].mutex);
+                if (runs[v].end - runs[v].begin > longest) {
+                    longest = runs[v].end - runs[v].begin;
+                    victim = v;
+                }
+            }
+            if (victim < 0)
+                return false;
+
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(runs[victim].mutex);
+                size_t left = runs[victim].end - runs[victim].begin;
+                if (left == 0)
+                    continue;
+                end = runs[victim].end;
+                begin = end - (left + 1) / 2;
+                runs[victim].end = begin;
+            }
+            std::lock_guard<std::mutex> lock(runs[w].mutex);
+            runs[w].begin = begin;
+            runs[w].end = end;
+            return true;
+        }
+    };
+
+    auto work = [&](int w) {
+        size_t task;
+        while (take(w, task) || (steal(w) && take(w, task))) {
+            f(task, w);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int w = 1; w < threads; w++) {
+        workers.emplace_back(work, w);
+    }
+    work(0);
+    for (auto &t : workers) {
+        t.join();
+    }
+}
+
+// A fixed set of threads that run one function together, for work that is
+// split the same way every time, many times a second. run(f) calls
+// f(worker) once for each worker in [0, size()), worker 0 on the calling
+// thread, and returns when every call has; the first exception thrown by
+// any of them is rethrown. Calls to run() from several threads take turns.
+struct WorkerPool {
+    explicit WorkerPool(int threads) : m_size{std::max(threads, 1)} {
+        for (int w = 1; w < m_size; w++) {
+            m_threads.emplace_back([this, w] { loop(w); });
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &t : m_threads) {
+            t.join();
+        }
+    }
+
+    int size() const { return m_size; }
+
+    // Worker w's share [begin, end) of n items: consecutive runs of about
+    // n / size() items that start at multiples of align.
+    std::pair<size_t, size_t> share(size_t n, int w, size_t align = 1) const {
+        size_t blocks = (n + align - 1) / align;
+        size_t begin = blocks * w / m_size * align;
+        size_t end = blocks * (w + 1) / m_size * align;
+        return {std::min(begin, n), std::min(end, n)};
+    }
+
+    void run(const std::function<void(int)> &f) {
+        std::lock_guard<std::mutex> turn(m_turn);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &f;
+            m_pending = m_size - 1;
+            m_error = nullptr;
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        std::exception_ptr error;
+        try {
+            f(0);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+        if (!error)
+            error = m_error;
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+  private:
+    void loop(int w) {
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(int)> *task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] {
+                    return m_stop || m_generation != seen;
+                });
+                if (m_stop)
+                    return;
+                seen = m_generation;
+                task = m_task;
+            }
+
+            std::exception_ptr error;
+            try {
+                (*task)(w);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error && !m_error)
+                m_error = error;
+            if (--m_pending == 0)
+                m_done.notify_one();
+        }
+    }
+
+    int m_size;
+    std::vector<std::thread> m_threads;
+    std::mutex m_turn;
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_done;
+    const std::function<void(int)> *m_task = nullptr;
+    uint64_t m_generation = 0;
+    int m_pending = 0;
+    std::exception_ptr m_error;
+    bool m_stop = false;
+};
@@ -0,0 +1,475 @@
+#include "lib/fmt/include/fmt/format.h"
+#include "pennies.h"
+#include "pool.h"
+#include "rng.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Hosts many independent learner sessions behind a Unix domain socket.
+// Clients send one request per line and get one response line per request,
+// in order, so any number of requests can be pipelined:
+//
+//   NEW [ROUNDS [SEED]]     OK <id>        ROUNDS 0 is a streaming session
+//   PREDICT <id>            OK <-1|1>      the machine commits to a move
+//   UPDATE <id> <-1|1>      OK <rounds> <human score> <cpu score>
+//   STATS <id>              OK <rounds> <human score> <cpu score>
+//                              <left %> <right %>
+//   CLOSE <id>              OK
+//
+// UPDATE plays the human's move against the last PREDICT, predicting first
+// if there was none. Errors are answered with ERR <message>. Connections
+// are spread over worker threads, each running its own epoll loop; the
+// sessions live in a table sharded by id, and any worker can serve any
+// session. With --snapshot-dir and --idle, sessions idle for that long are
+// evicted to snapshot files and restored on their next request.
+
+struct ServerOptions {
+    std::string socket = "/tmp/mindreader.sock";
+    int threads = 0;
+    int rounds = 101;
+    std::string snapshot_dir;
+    double idle = 0; // seconds before an idle session is evicted
+};
+
+using Learner = ExpertAdvice<int, int, BinaryActions>;
+using Clock = std::chrono::steady_clock;
+
+struct Session {
+    std::mutex mutex;
+    Learner E;
+    int pending = 0; // the prediction of this round, once made
+    Clock::time_point last_used = Clock::now();
+    bool evicted = false;
+
+    Session(const ExpertPool &pool, int rounds)
+        : E{zero_one_loss, rounds, pool.banks, {}} {}
+};
+
+// Sessions by id. With a snapshot directory, sessions left idle are saved
+// to it and dropped from memory, and restored the next time they are used.
+struct SessionTable {
+    static constexpr size_t shards = 64;
+
+    struct Entry {
+        std::shared_ptr<Session> session; // null while evicted
+        int rounds;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> sessions;
+    };
+
+    const ExpertPool &pool;
+    std::string dir;
+    Shard shard[shards];
+    std::atomic<uint64_t> next_id{1};
+
+    SessionTable(const ExpertPool &pool, std::string dir)
+        : pool{pool}, dir{dir} {}
+
+    std::string path(uint64_t id) const {
+        return fmt::format("{}/{}.snap", dir, id);
+    }
+
+    uint64_t add(int rounds, uint64_t seed) {
+        auto s = std::make_shared<Session>(pool, rounds);
+        s->E.seed(seed);
+        s->E.reset();
+        uint64_t id = next_id++;
+        auto &sh = shard[id % shards];
+        std::lock_guard<std::mutex> lock(sh.mutex);
+        sh.sessions.emplace(id, Entry{std::move(s), rounds});
+        return id;
+    }
+
+    // Runs f on the session, locked.
+    template <typename F> auto with(uint64_t id, F &&f) {
+        while (true) {
+            auto s = find(id);
+            std::lock_guard<std::mutex> lock(s->mutex);
+            // Evicted between the lookup and the lock: look again.
+            if (s->evicted)
+                continue;
+            s->last_used = Clock::now();
+            return f(*s);
+        }
+    }
+
+    void remove(uint64_t id) {
+        auto &sh = shard[id % shards];
+        std::lock_guard<std::mutex> lock(sh.mutex);
+        auto it = sh.sessions.find(id);
+        if (it == sh.sessions.end())
+            throw std::invalid_argument(fmt::format("no session {}", id));
+        if (!it->second.session)
+            unlink(path(id).c_str());
+        sh.sessions.erase(it);
+    }
+
+    // Saves and drops the sessions unused for longer than idle seconds.
+    size_t evict(double idle) {
+        auto now = Clock::now();
+        size_t evicted = 0;
+        for (auto &sh : shard) {
+            std::lock_guard<std::mutex> lock(sh.mutex);
+            for (auto &it : sh.sessions) {
+                auto s = it.second.session;
+                if (!s || !s->mutex.try_lock())
+                    continue;
+                std::lock_guard<std::mutex> session(s->mutex,
+                                                    std::adopt_lock);
+                double age =
+                    std::chrono::duration<double>(now - s->last_used).count();
+                if (age < idle || s->pending != 0)
+                    continue;
+                save_snapshot(s->E, path(it.first));
+                s->evicted = true;
+                it.second.session.reset();
+                evicted++;
+            }
+        }
+        return evicted;
+    }
+
+  private:
+    std::shared_ptr<Session> find(uint64_t id) {
+        auto &sh = shard[id % shards];
+        std::lock_guard<std::mutex> lock(sh.mutex);
+        auto it = sh.sessions.find(id);
+        if (it == sh.sessions.end())
+            throw std::invalid_argument(fmt::format("no session {}", id));
+        auto &entry = it->second;
+        if (!entry.session) {
+            auto s = std::make_shared<Session>(pool, entry.rounds);
+            load_snapshot(s->E, path(id));
+            unlink(path(id).c_str());
+            entry.session = std::move(s);
+        }
+        return entry.session;
+    }
+};
+
+static std::atomic<bool> stopping{false};
+
+static void on_signal(int) { stopping = true; }
+
+static int parse_move(const std::string &s) {
+    if (s == "-1")
+        return -1;
+    if (s == "1")
+        return 1;
+    throw std::invalid_argument("move must be -1 or 1: " + s);
+}
+
+struct Server {
+    ServerOptions opts;
+    ExpertPool pool;
+    SessionTable table;
+
+    Server(ServerOptions opts)
+        : opts{opts}, pool{default_pool()}, table{pool, opts.snapshot_dir} {}
+
+    std::string scores(const Learner &E) {
+        int human = (int)E.cumulative_loss;
+        return fmt::format("{} {} {}", E.round_counter, human,
+                           E.round_counter - human);
+    }
+
+    // Answers one request line, without the newline.
+    std::string handle(const std::string &line) {
+        std::istringstream in(line);
+        std::string command, arg;
+        std::vector<std::string> args;
+        in >> command;
+        while (in >> arg) {
+            args.push_back(arg);
+        }
+
+        auto id = [&]() {
+            if (args.empty())
+                throw std::invalid_argument(command + " needs a session id");
+            return std::stoull(args[0]);
+        };
+
+        if (command == "NEW") {
+            int rounds = args.size() > 0 ? std::stoi(args[0]) : opts.rounds;
+            uint64_t seed =
+                args.size() > 1 ? std::stoull(args[1]) : random_seed();
+            if (rounds < 0)
+                throw std::invalid_argument("rounds must not be negative");
+            return fmt::format("OK {}", table.add(rounds, seed));
+        }
+
+        if (command == "PREDICT") {
+            return table.with(id(), [](Session &s) {
+                if (s.E.gameover())
+                    throw std::invalid_argument("game over");
+                if (s.pending == 0)
+                    s.pending = s.E.predict();
+                return fmt::format("OK {}", s.pending);
+            });
+        }
+
+        if (command == "UPDATE") {
+            auto session = id();
+            if (args.size() < 2)
+                throw std::invalid_argument("UPDATE needs a move");
+            int y = parse_move(args[1]);
+            return table.with(session, [&](Session &s) {
+                if (s.E.gameover())
+                    throw std::invalid_argument("game over");
+                int p = s.pending != 0 ? s.pending : s.E.predict();
+                s.E.update(p, y);
+                s.pending = 0;
+                return "OK " + scores(s.E);
+            });
+        }
+
+        if (command == "STATS") {
+            return table.with(id(), [&](Session &s) {
+                return fmt::format("OK {} {:.2f} {:.2f}", scores(s.E),
+                                   s.E.action_pct_weight(-1),
+                                   s.E.action_pct_weight(1));
+            });
+        }
+
+        if (command == "CLOSE") {
+            table.remove(id());
+            return "OK";
+        }
+
+        throw std::invalid_argument("unknown command " + command);
+    }
+
+    struct Connection {
+        std::string in, out;
+        bool writing = false;
+    };
+
+    // Serves the connections added to epfd until the server stops.
+    void work(int epfd) {
+        std::unordered_map<int, Connection> connections;
+        epoll_event events[64];
+        char buffer[65536];
+
+        while (!stopping) {
+            int k = epoll_wait(epfd, events, 64, 100);
+            for (int e = 0; e < k; e++) {
+                int fd = events[e].data.fd;
+                auto &c = connections[fd];
+                bool closed = (events[e].events & (EPOLLHUP | EPOLLERR)) != 0;
+
+                if (events[e].events & EPOLLIN) {
+                    ssize_t r;
+                    while ((r = read(fd, buffer, sizeof buffer)) > 0) {
+                        c.in.append(buffer, r);
+                    }
+                    if (r == 0 || (r < 0 && errno != EAGAIN))
+                        closed = true;
+
+                    size_t start = 0, end;
+                    while ((end = c.in.find('\n', start)) !=
+                           std::string::npos) {
+                        std::string line = c.in.substr(start, end - start);
+                        if (!line.empty() && line.back() == '\r')
+                            line.pop_back();
+                        try {
+                            c.out += handle(line);
+                        } catch (const std::exception &ex) {
+                            c.out += "ERR ";
+                            c.out += ex.what();
+                        }
+                        c.out += '\n';
+                        start = end + 1;
+                    }
+                    c.in.erase(0, start);
+                }
+
+                while (!c.out.empty()) {
+                    ssize_t w = write(fd, c.out.data(), c.out.size());
+                    if (w <= 0) {
+                        if (w < 0 && errno != EAGAIN)
+                            closed = true;
+                        break;
+                    }
+                    c.out.erase(0, w);
+                }
+
+                if (closed) {
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+                    close(fd);
+                    connections.erase(fd);
+                    continue;
+                }
+
+                // Wait for the socket to drain before writing the rest.
+                bool writing = !c.out.empty();
+                if (writing != c.writing) {
+                    epoll_event ev{};
+                    ev.events = EPOLLIN | (writing ? (uint32_t)EPOLLOUT : 0u);
+                    ev.data.fd = fd;
+                    epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+                    c.writing = writing;
+                }
+            }
+        }
+
+        for (auto &c : connections) {
+            close(c.first);
+        }
+    }
+
+    int run() {
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0)
+            throw std::runtime_error(std::strerror(errno));
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (opts.socket.size() >= sizeof addr.sun_path)
+            throw std::invalid_argument("socket path too long");
+        std::strcpy(addr.sun_path, opts.socket.c_str());
+        unlink(opts.socket.c_str());
+        if (bind(listener, (sockaddr *)&addr, sizeof addr) < 0 ||
+            listen(listener, 1024) < 0)
+            throw std::runtime_error(opts.socket + ": " +
+                                     std::strerror(errno));
+
+        std::vector<int> epfds;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < opts.threads; t++) {
+            epfds.push_back(epoll_create1(0));
+            workers.emplace_back([this, fd = epfds.back()] { work(fd); });
+        }
+
+        fmt::print("mindreader-server: {} experts, {} threads, listening "
+                   "on {}\n",
+                   pool.labels.size(), opts.threads, opts.socket);
+        std::fflush(stdout);
+
+        // New connections go to the workers in turn.
+        size_t next = 0;
+        auto last_eviction = Clock::now();
+        while (!stopping) {
+            if (!opts.snapshot_dir.empty() && opts.idle > 0 &&
+                Clock::now() - last_eviction > std::chrono::seconds(1)) {
+                try {
+                    table.evict(opts.idle);
+                } catch (const std::exception &e) {
+                    fmt::print(stderr, "mindreader-server: {}\n", e.what());
+                }
+                last_eviction = Clock::now();
+            }
+
+            pollfd p{listener, POLLIN, 0};
+            if (poll(&p, 1, 100) <= 0)
+                continue;
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epfds[next++ % epfds.size()], EPOLL_CTL_ADD, fd, &ev);
+        }
+
+        for (auto &w : workers) {
+            w.join();
+        }
+        for (auto fd : epfds) {
+            close(fd);
+        }
+        close(listener);
+        unlink(opts.socket.c_str());
+        return 0;
+    }
+};
+
+static void usage() {
+    fmt::print(stderr, "usage: mindreader-server [--socket PATH] "
+                       "[--threads T] [--rounds R]\n"
+                       "                         [--snapshot-dir DIR] "
+                       "[--idle SECONDS]\n");
+}
+
+static ServerOptions parse_options(int argc, char **argv) {
+    ServerOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--socket")
+            opts.socket = value;
+        else if (arg == "--threads")
+            opts.threads = std::stoi(value);
+        else if (arg == "--rounds")
+            opts.rounds = std::stoi(value);
+        else if (arg == "--snapshot-dir")
+            opts.snapshot_dir = value;
+        else if (arg == "--idle")
+            opts.idle = std::stod(value);
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+
+    if (opts.rounds < 0)
+        throw std::invalid_argument("rounds must not be negative");
+    if (opts.idle > 0 && opts.snapshot_dir.empty())
+        throw std::invalid_argument("--idle needs --snapshot-dir");
+    if (opts.threads <= 0)
+        opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    return opts;
+}
+
+int main(int argc, char **argv) {
+    ServerOptions opts;
+    try {
+        opts = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-server: {}\n", e.what());
+        usage();
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        Server server(opts);
+        return server.run();
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-server: {}\n", e.what());
+        return 1;
+    }
+}
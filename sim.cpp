@@ -0,0 +1,212 @@
+#include "lib/fmt/include/fmt/format.h"
+#include "gamelog.h"
+#include "opponent.h"
+#include "pennies.h"
+#include "pool.h"
+#include "rng.h"
+#include "util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimOptions {
+    long games = 100000;
+    int rounds = 101;
+    int threads = 0;
+    std::string opponent = "random";
+    uint64_t seed = 0;
+    bool seeded = false;
+    std::string log;
+    bool log_weights = false;
+    LossMode loss_mode = LossMode::sampled;
+};
+
+struct SimStats {
+    long games = 0;
+    long rounds = 0;
+    long cpu_wins = 0;
+    long human_wins = 0;
+    long ties = 0;
+    double loss_sum = 0.0;
+    double loss_sq_sum = 0.0;
+
+    void add(const GameResult &r) {
+        games++;
+        rounds += r.rounds;
+        if (r.cpu_score > r.human_score)
+            cpu_wins++;
+        else if (r.cpu_score < r.human_score)
+            human_wins++;
+        else
+            ties++;
+
+        // The machine's loss is the fraction of rounds the human won.
+        double loss = r.rounds > 0 ? (double)r.human_score / r.rounds : 0.0;
+        loss_sum += loss;
+        loss_sq_sum += loss * loss;
+    }
+
+    void merge(const SimStats &s) {
+        games += s.games;
+        rounds += s.rounds;
+        cpu_wins += s.cpu_wins;
+        human_wins += s.human_wins;
+        ties += s.ties;
+        loss_sum += s.loss_sum;
+        loss_sq_sum += s.loss_sq_sum;
+    }
+};
+
+static void usage() {
+    fmt::print(stderr,
+               "usage: mindreader-sim [--games N] [--rounds R] "
+               "[--threads T] [--opponent SPEC] [--seed S]\n"
+               "                      [--log PATH] [--log-weights] "
+               "[--expected-loss]\n"
+               "opponents: random, biased:P, alternate, pattern:LLR, "
+               "mirror, contrarian, stay:P\n");
+}
+
+static SimOptions parse_options(int argc, char **argv) {
+    SimOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (arg == "--log-weights") {
+            opts.log_weights = true;
+            continue;
+        }
+        if (arg == "--expected-loss") {
+            opts.loss_mode = LossMode::expected;
+            continue;
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--games")
+            opts.games = std::stol(value);
+        else if (arg == "--rounds")
+            opts.rounds = std::stoi(value);
+        else if (arg == "--threads")
+            opts.threads = std::stoi(value);
+        else if (arg == "--opponent")
+            opts.opponent = value;
+        else if (arg == "--seed") {
+            opts.seed = std::stoull(value);
+            opts.seeded = true;
+        }
+        else if (arg == "--log")
+            opts.log = value;
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+
+    if (opts.games <= 0 || opts.rounds <= 0)
+        throw std::invalid_argument("games and rounds must be positive");
+    if (opts.threads <= 0)
+        opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!opts.seeded)
+        opts.seed = random_seed();
+    return opts;
+}
+
+int main(int argc, char **argv) {
+    SimOptions opts;
+    try {
+        opts = parse_options(argc, argv);
+        make_opponent(opts.opponent);
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-sim: {}\n", e.what());
+        usage();
+        return 1;
+    }
+
+    auto pool = default_pool();
+    auto n_experts = pool.labels.size();
+
+    // Games are handed out in small batches so that threads finishing early
+    // pick up the remaining work.
+    const long batch = 64;
+    std::atomic<long> next_game{0};
+    std::vector<SimStats> stats(opts.threads);
+    std::vector<std::thread> workers;
+    std::mutex log_mutex;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int t = 0; t < opts.threads; t++) {
+        workers.emplace_back([&, t] {
+            auto E = ExpertAdvice<int, int, BinaryActions>(
+                zero_one_loss, opts.rounds, pool.banks, pool.labels,
+                opts.loss_mode);
+            auto opponent = make_opponent(opts.opponent);
+            GameRecord record;
+            auto log = opts.log.empty() ? nullptr : &record;
+
+            while (true) {
+                long first = next_game.fetch_add(batch);
+                if (first >= opts.games)
+                    break;
+                long last = std::min(first + batch, opts.games);
+                for (long g = first; g < last; g++) {
+                    // Every game has its own streams, so the results do not
+                    // depend on how games are spread over threads.
+                    E.seed(opts.seed, 2 * g);
+                    seed_runif(opts.seed, 2 * g + 1);
+                    stats[t].add(
+                        play_game(E, opponent, log, opts.log_weights));
+                    if (log) {
+                        std::lock_guard<std::mutex> lock(log_mutex);
+                        append_game(opts.log, record);
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+
+    SimStats total;
+    for (const auto &s : stats) {
+        total.merge(s);
+    }
+
+    double n = (double)total.games;
+    double mean = total.loss_sum / n;
+    double var = std::max(0.0, total.loss_sq_sum / n - mean * mean);
+
+    fmt::print("opponent        {}\n", opts.opponent);
+    fmt::print("seed            {}\n", opts.seed);
+    fmt::print("experts         {}\n", n_experts);
+    fmt::print("threads         {}\n", opts.threads);
+    fmt::print("games           {}\n", total.games);
+    fmt::print("rounds          {}\n", total.rounds);
+    fmt::print("seconds         {:.3f}\n", seconds);
+    fmt::print("games/sec       {:.1f}\n", n / seconds);
+    fmt::print("rounds/sec      {:.1f}\n", total.rounds / seconds);
+    fmt::print("cpu wins        {:.4f}\n", total.cpu_wins / n);
+    fmt::print("human wins      {:.4f}\n", total.human_wins / n);
+    fmt::print("ties            {:.4f}\n", total.ties / n);
+    fmt::print("loss mean       {:.4f}\n", mean);
+    fmt::print("loss stddev     {:.4f}\n", std::sqrt(var));
+    fmt::print("loss stderr     {:.5f}\n", std::sqrt(var / n));
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "snapshot.h"
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static SnapshotError system_error(const std::string &path) {
+    return SnapshotError(path + ": " + std::strerror(errno));
+}
+
+MappedFile::MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw system_error(path);
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        throw system_error(path);
+    }
+    size = st.st_size;
+    if (size > 0) {
+        void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw system_error(path);
+        }
+        data = (const char *)p;
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data)
+        munmap((void *)data, size);
+}
+
+void write_file(const std::string &path, const std::string &bytes) {
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw system_error(tmp);
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t w = write(fd, bytes.data() + written, bytes.size() - written);
+        if (w < 0) {
+            close(fd);
+            unlink(tmp.c_str());
+            throw system_error(tmp);
+        }
+        written += w;
+    }
+    close(fd);
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        throw system_error(path);
+    }
+}
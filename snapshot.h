@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Learner snapshots: the state of a game, without the expert pool it was
+// played with, as raw fields and arrays laid end to end, each padded to 8
+// bytes. Writing is one pass over the state; restoring maps the file and
+// copies each array out of it in one piece, with no parsing.
+//
+// Stateful experts and banks take part by exposing their mutable state as
+// a tuple of references,
+//
+//     auto state() { return std::tie(accum, weight, count); }
+//
+// of trivially copyable values and std::vectors of them, or by defining
+// save(SnapshotWriter &) const and load(SnapshotReader &) themselves.
+
+constexpr uint64_t snapshot_magic = 0x50414e5344524dull; // "MRDSNAP"
+constexpr uint64_t snapshot_version = 2;
+
+struct SnapshotError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct SnapshotWriter {
+    std::string bytes;
+
+    template <typename T> void put(const T &x) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "snapshot fields must be trivially copyable");
+        append(&x, sizeof x);
+    }
+
+    template <typename T> void put(const std::vector<T> &v) {
+        put((uint64_t)v.size());
+        append(v.data(), v.size() * sizeof(T));
+    }
+
+    template <typename... T> void put(const std::tuple<T &...> &t) {
+        std::apply([this](const auto &... x) { (put(x), ...); }, t);
+    }
+
+  private:
+    void append(const void *p, size_t n) {
+        bytes.append((const char *)p, n);
+        bytes.resize((bytes.size() + 7) / 8 * 8);
+    }
+};
+
+struct SnapshotReader {
+    const char *p, *end;
+    SnapshotReader(const char *p, size_t n) : p{p}, end{p + n} {}
+
+    template <typename T> void get(T &x) {
+        std::memcpy(&x, take(sizeof x), sizeof x);
+    }
+
+    template <typename T> void get(std::vector<T> &v) {
+        uint64_t n;
+        get(n);
+        if (n > (size_t)(end - p) / sizeof(T))
+            throw SnapshotError("snapshot: truncated");
+        v.resize(n);
+        std::memcpy(v.data(), take(n * sizeof(T)), n * sizeof(T));
+    }
+
+    template <typename... T> void get(const std::tuple<T &...> &t) {
+        std::apply([this](auto &... x) { (get(x), ...); }, t);
+    }
+
+    template <typename T> T get() {
+        T x;
+        get(x);
+        return x;
+    }
+
+    // An array of n values in place, without copying. Arrays start at
+    // multiples of 8 bytes from the start of the data.
+    template <typename T> const T *view(size_t n) {
+        if (n > (size_t)(end - p) / sizeof(T))
+            throw SnapshotError("snapshot: truncated");
+        return (const T *)take(n * sizeof(T));
+    }
+
+    bool done() const { return p == end; }
+
+  private:
+    const char *take(size_t n) {
+        size_t padded = (n + 7) / 8 * 8;
+        if ((size_t)(end - p) < padded)
+            throw SnapshotError("snapshot: truncated");
+        auto q = p;
+        p += padded;
+        return q;
+    }
+};
+
+template <typename T, typename = void> struct has_state : std::false_type {};
+
+template <typename T>
+struct has_state<T, std::void_t<decltype(std::declval<T &>().state())>>
+    : std::true_type {};
+
+template <typename T, typename = void>
+struct has_snapshot : std::false_type {};
+
+template <typename T>
+struct has_snapshot<
+    T, std::void_t<decltype(std::declval<const T &>().save(
+                       std::declval<SnapshotWriter &>())),
+                   decltype(std::declval<T &>().load(
+                       std::declval<SnapshotReader &>()))>>
+    : std::true_type {};
+
+// Saves or loads whatever state x exposes; stateless x has none.
+template <typename T> void save_state(SnapshotWriter &w, const T &x) {
+    if constexpr (has_snapshot<T>::value)
+        x.save(w);
+    else if constexpr (has_state<T>::value)
+        w.put(const_cast<T &>(x).state());
+}
+
+template <typename T> void load_state(SnapshotReader &r, T &x) {
+    if constexpr (has_snapshot<T>::value)
+        x.load(r);
+    else if constexpr (has_state<T>::value)
+        r.get(x.state());
+}
+
+// A read-only memory map of a whole file.
+struct MappedFile {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+// Writes bytes to path through a temporary file, so that a crash never
+// leaves a partial snapshot behind.
+void write_file(const std::string &path, const std::string &bytes);
+
+// Saves any learner with save(SnapshotWriter &) to path, and loads it back.
+template <typename L>
+void save_snapshot(const L &learner, const std::string &path) {
+    SnapshotWriter w;
+    learner.save(w);
+    write_file(path, w.bytes);
+}
+
+template <typename L>
+void load_snapshot(L &learner, const std::string &path) {
+    MappedFile file(path);
+    SnapshotReader r(file.data, file.size);
+    learner.load(r);
+}
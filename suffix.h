@@ -0,0 +1,156 @@
+#pragma once
+
+#include "banks.h"
+#include "pennies.h"
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// An online suffix automaton over the joint history of the game, one
+// symbol per round: 2 * (prediction > 0) + (outcome > 0). After each round
+// it knows the longest suffix of the history that occurred before, and the
+// round that followed its first occurrence, in amortized O(1) per round.
+//
+// To bound memory in long sessions the automaton covers the last window
+// rounds: when twice that many have been seen it is rebuilt from the last
+// window, which is still O(1) per round amortized.
+struct SuffixAutomaton {
+    struct State {
+        int len;   // of the longest string in the state
+        int link;  // suffix link, -1 for the root
+        int first; // end of the first occurrence
+        int next[4];
+    };
+
+    size_t window;
+    std::vector<State> states;
+    std::vector<uint8_t> symbols;
+    int last = 0;
+    int match = 0; // state of the longest earlier suffix, 0 if none
+
+    SuffixAutomaton(size_t window = 1 << 16) : window{window} { reset(); }
+
+    void reset() {
+        states.assign(1, State{0, -1, -1, {-1, -1, -1, -1}});
+        symbols.clear();
+        last = 0;
+        match = 0;
+    }
+
+    auto state() { return std::tie(states, symbols, last, match); }
+
+    void push(int prediction, int outcome) {
+        if (symbols.size() >= 2 * window) {
+            std::vector<uint8_t> kept(symbols.end() - window, symbols.end());
+            reset();
+            for (auto c : kept) {
+                extend(c);
+            }
+        }
+        extend(2 * (prediction > 0) + (outcome > 0));
+    }
+
+    // The move the human made in the round after the first occurrence of
+    // the longest earlier suffix, 0 if there is none.
+    int follow() const {
+        if (match == 0)
+            return 0;
+        return symbols[states[match].first + 1] & 1 ? 1 : -1;
+    }
+
+  private:
+    void extend(int c) {
+        int cur = (int)states.size();
+        int pos = (int)symbols.size();
+        symbols.push_back((uint8_t)c);
+        states.push_back(
+            State{states[last].len + 1, 0, pos, {-1, -1, -1, -1}});
+
+        int p = last;
+        while (p != -1 && states[p].next[c] == -1) {
+            states[p].next[c] = cur;
+            p = states[p].link;
+        }
+        if (p != -1) {
+            int q = states[p].next[c];
+            if (states[p].len + 1 == states[q].len) {
+                states[cur].link = q;
+            } else {
+                int clone = (int)states.size();
+                State s = states[q];
+                s.len = states[p].len + 1;
+                states.push_back(s);
+                while (p != -1 && states[p].next[c] == q) {
+                    states[p].next[c] = clone;
+                    p = states[p].link;
+                }
+                states[q].link = clone;
+                states[cur].link = clone;
+            }
+        }
+        last = cur;
+        match = states[cur].link;
+    }
+};
+
+// Plays the move that followed the first occurrence of the longest repeated
+// suffix with probability p, and a fair coin before any suffix repeats.
+struct SuffixMatchExpert {
+    double p;
+    SuffixAutomaton automaton;
+    SuffixMatchExpert(double p) : p{p} {}
+
+    void reset() { automaton.reset(); }
+    auto state() { return automaton.state(); }
+
+    void observe(int prediction, int outcome) {
+        automaton.push(prediction, outcome);
+    }
+
+    void probabilities(double *q) {
+        int f = automaton.follow();
+        binary_probabilities(f == 0 ? 0.5 : f < 0 ? p : 1 - p, q);
+    }
+
+    int operator()(double u) {
+        int f = automaton.follow();
+        if (f == 0)
+            return u <= 0.5 ? -1 : 1;
+        return u <= p ? f : -f;
+    }
+};
+
+// Suffix-match experts with several p, sharing one automaton.
+struct SuffixMatchBank {
+    std::vector<double> p;
+    SuffixAutomaton automaton;
+    SuffixMatchBank(std::vector<double> p) : p{p} {}
+
+    size_t size() const { return p.size(); }
+    void reset() { automaton.reset(); }
+    auto state() { return automaton.state(); }
+
+    void observe(int prediction, int outcome) {
+        automaton.push(prediction, outcome);
+    }
+
+    void advise(const double *u, int *out) {
+        int f = automaton.follow();
+        if (f == 0) {
+            threshold_advice(u, 0.5, out, size());
+            return;
+        }
+        for (size_t i = 0; i < size(); i++) {
+            out[i] = u[i] <= p[i] ? f : -f;
+        }
+    }
+
+    void probabilities(double *q, size_t actions) {
+        int f = automaton.follow();
+        for (size_t i = 0; i < size(); i++) {
+            double x = f == 0 ? 0.5 : f < 0 ? p[i] : 1 - p[i];
+            binary_probabilities(x, q + i * actions);
+        }
+    }
+};
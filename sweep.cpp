@@ -0,0 +1,365 @@
+#include "lib/fmt/include/fmt/format.h"
+#include "gamelog.h"
+#include "opponent.h"
+#include "pennies.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "util.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Plays many candidate pools against the same opponents and reports each
+// one's loss, win rate and regret. Game g against an opponent uses the same
+// streams for every pool, so pools are compared on the same games.
+
+struct SweepOptions {
+    std::vector<std::string> configs;
+    std::vector<std::string> opponents;
+    std::vector<std::string> logs;
+    long games = 1000;
+    int rounds = 101;
+    int threads = 0;
+    int learner_threads = 1; // per learner, for very large pools
+    long batch = 16;
+    uint64_t seed = 1;
+    LossMode loss_mode = LossMode::sampled;
+};
+
+// One opponent: either a simulated one or the games of a recorded log,
+// whose human moves are replayed to the learner.
+struct SweepOpponent {
+    std::string name;
+    std::string spec;
+    std::unique_ptr<GameLog> log;
+    long games = 0;
+};
+
+// The counts are integers, so the totals do not depend on the order in
+// which workers add them up. Regret is fractional under expected loss; it
+// is kept per game and summed in game order once every game is played.
+struct SweepStats {
+    long games = 0;
+    long rounds = 0;
+    long losses = 0;
+    long cpu_wins = 0;
+    double regret = 0.0; // the learner's losses minus the best expert's
+
+    void add(const SweepStats &s) {
+        games += s.games;
+        rounds += s.rounds;
+        losses += s.losses;
+        cpu_wins += s.cpu_wins;
+        regret += s.regret;
+    }
+};
+
+// Alternatives to the hand-picked grids, crossed with one another.
+static std::vector<std::string> default_configs() {
+    std::vector<std::string> proportion = {"", "proportion=0:1:0.1;"};
+    std::vector<std::string> exponential = {"",
+                                            "exponential=0.5:0.95:0.05;"};
+    std::vector<std::string> cosine = {"", "cosine=2:6:1;"};
+    std::vector<std::string> length_two = {"", "length_two=0.1:0.9:0.4;"};
+
+    std::vector<std::string> configs;
+    for (const auto &a : proportion) {
+        for (const auto &b : exponential) {
+            for (const auto &c : cosine) {
+                for (const auto &d : length_two) {
+                    auto spec = a + b + c + d;
+                    if (spec.empty())
+                        spec = "defaults";
+                    else
+                        spec.pop_back();
+                    configs.push_back(spec);
+                }
+            }
+        }
+    }
+    return configs;
+}
+
+static void usage() {
+    fmt::print(stderr,
+               "usage: mindreader-sweep [--config SPEC]... [--configs FILE]"
+               "\n"
+               "                        [--opponent SPEC]... [--log PATH]..."
+               "\n"
+               "                        [--games N] [--rounds R] "
+               "[--threads T] [--batch B] [--seed S]\n"
+               "                        [--learner-threads L] "
+               "[--expected-loss]\n"
+               "pool specs: defaults, or family=values;... with families "
+               "proportion, exponential,\n"
+               "            streak, correlated, cosine, phase, length_two, "
+               "context_tree,\n"
+               "            suffix_match, window, run\n"
+               "            and values 0.1,0.2 or 0:1:0.1\n");
+}
+
+static SweepOptions parse_options(int argc, char **argv) {
+    SweepOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        }
+        if (arg == "--expected-loss") {
+            opts.loss_mode = LossMode::expected;
+            continue;
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--config") {
+            opts.configs.push_back(value);
+        } else if (arg == "--configs") {
+            std::ifstream in(value);
+            if (!in)
+                throw std::invalid_argument("cannot read " + value);
+            std::string line;
+            while (std::getline(in, line)) {
+                if (!line.empty() && line[0] != '#')
+                    opts.configs.push_back(line);
+            }
+        } else if (arg == "--opponent") {
+            opts.opponents.push_back(value);
+        } else if (arg == "--log") {
+            opts.logs.push_back(value);
+        } else if (arg == "--games") {
+            opts.games = std::stol(value);
+        } else if (arg == "--rounds") {
+            opts.rounds = std::stoi(value);
+        } else if (arg == "--threads") {
+            opts.threads = std::stoi(value);
+        } else if (arg == "--learner-threads") {
+            opts.learner_threads = std::stoi(value);
+        } else if (arg == "--batch") {
+            opts.batch = std::stol(value);
+        } else if (arg == "--seed") {
+            opts.seed = std::stoull(value);
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+
+    if (opts.games <= 0 || opts.rounds <= 0 || opts.batch <= 0 ||
+        opts.learner_threads <= 0)
+        throw std::invalid_argument("games, rounds, batch and learner "
+                                    "threads must be positive");
+    if (opts.threads <= 0)
+        opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (opts.configs.empty())
+        opts.configs = default_configs();
+    if (opts.opponents.empty() && opts.logs.empty())
+        opts.opponents = {"random",    "biased:0.7", "alternate",
+                          "pattern:LLR", "mirror",   "contrarian",
+                          "stay:0.8"};
+    return opts;
+}
+
+using Learner = ExpertAdvice<int, int, BinaryActions>;
+
+// Adds a game to s and returns its regret.
+static double add_game(SweepStats &s, const Learner &E, const GameResult &r) {
+    double best = *std::max_element(E.scores.begin(), E.scores.end());
+    s.games++;
+    s.rounds += r.rounds;
+    s.losses += r.human_score;
+    s.cpu_wins += r.cpu_score > r.human_score;
+    return E.cumulative_loss + best;
+}
+
+// Feeds the recorded human moves of a game to E, with the GUI's rules for
+// when a game ends.
+static GameResult replay_game(Learner &E, const GameView &game, int rounds) {
+    GameResult r;
+    size_t n = std::min<size_t>(game.rounds, rounds);
+    for (size_t i = 0; i < n && r.cpu_score <= rounds / 2 &&
+                       r.human_score <= rounds / 2;
+         i++) {
+        int y = game.outcome(i);
+        int p = E.predict();
+        E.update(p, y);
+        r.rounds++;
+        if (p == y)
+            r.cpu_score++;
+        else
+            r.human_score++;
+    }
+    return r;
+}
+
+int main(int argc, char **argv) {
+    SweepOptions opts;
+    std::vector<PoolSpec> specs;
+    std::vector<SweepOpponent> opponents;
+    try {
+        opts = parse_options(argc, argv);
+        for (const auto &config : opts.configs) {
+            specs.push_back(PoolSpec::parse(config));
+        }
+        for (const auto &spec : opts.opponents) {
+            make_opponent(spec);
+            opponents.push_back({spec, spec, nullptr, opts.games});
+        }
+        for (const auto &path : opts.logs) {
+            auto log = std::make_unique<GameLog>(path);
+            long games = (long)log->games.size();
+            opponents.push_back({"log:" + path, "", std::move(log), games});
+        }
+    } catch (const std::exception &e) {
+        fmt::print(stderr, "mindreader-sweep: {}\n", e.what());
+        usage();
+        return 1;
+    }
+
+    // A task is one batch of games of one pool against one opponent. Tasks
+    // are numbered pool by pool, so a worker's run of consecutive tasks
+    // rarely needs a new learner.
+    struct Task {
+        size_t config, opponent;
+        long first, last;
+    };
+    std::vector<Task> tasks;
+    for (size_t c = 0; c < specs.size(); c++) {
+        for (size_t o = 0; o < opponents.size(); o++) {
+            long games = opponents[o].games;
+            for (long g = 0; g < games; g += opts.batch) {
+                tasks.push_back({c, o, g, std::min(g + opts.batch, games)});
+            }
+        }
+    }
+
+    auto n_results = specs.size() * opponents.size();
+    std::vector<std::vector<SweepStats>> stats(
+        opts.threads, std::vector<SweepStats>(n_results));
+    std::vector<std::vector<double>> regret(n_results);
+    for (size_t r = 0; r < n_results; r++) {
+        regret[r].resize(opponents[r % opponents.size()].games);
+    }
+
+    struct Worker {
+        size_t config = SIZE_MAX;
+        std::unique_ptr<Learner> E;
+        std::vector<Opponent> opponents;
+    };
+    std::vector<Worker> workers(opts.threads);
+    for (auto &w : workers) {
+        for (const auto &o : opponents) {
+            w.opponents.push_back(o.log ? Opponent() : make_opponent(o.spec));
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    parallel_for(tasks.size(), opts.threads, [&](size_t i, int t) {
+        const auto &task = tasks[i];
+        auto &w = workers[t];
+        if (w.config != task.config) {
+            const auto &spec = specs[task.config];
+            w.E = std::make_unique<Learner>(zero_one_loss, opts.rounds,
+                                            spec.banks(), spec.labels(),
+                                            opts.loss_mode);
+            w.E->set_threads(opts.learner_threads);
+            w.config = task.config;
+        }
+        auto &E = *w.E;
+        const auto &opponent = opponents[task.opponent];
+        auto result = task.config * opponents.size() + task.opponent;
+        auto &s = stats[t][result];
+
+        for (long g = task.first; g < task.last; g++) {
+            E.seed(opts.seed, 2 * g);
+            seed_runif(opts.seed, 2 * g + 1);
+            if (opponent.log) {
+                E.reset();
+                auto r = replay_game(E, opponent.log->games[g], opts.rounds);
+                regret[result][g] = add_game(s, E, r);
+            } else {
+                regret[result][g] =
+                    add_game(s, E, play_game(E, w.opponents[task.opponent]));
+            }
+        }
+    });
+
+    auto stop = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(stop - start).count();
+
+    std::vector<SweepStats> total(n_results);
+    long games = 0;
+    for (const auto &thread_stats : stats) {
+        for (size_t r = 0; r < n_results; r++) {
+            total[r].add(thread_stats[r]);
+            games += thread_stats[r].games;
+        }
+    }
+    for (size_t r = 0; r < n_results; r++) {
+        for (auto x : regret[r]) {
+            total[r].regret += x;
+        }
+    }
+
+    fmt::print("configs         {}\n", specs.size());
+    fmt::print("opponents       {}\n", opponents.size());
+    fmt::print("threads         {}\n", opts.threads);
+    fmt::print("learner threads {}\n", opts.learner_threads);
+    fmt::print("seed            {}\n", opts.seed);
+    fmt::print("games           {}\n", games);
+    fmt::print("seconds         {:.3f}\n", seconds);
+    fmt::print("games/sec       {:.1f}\n\n", games / seconds);
+
+    for (size_t c = 0; c < specs.size(); c++) {
+        fmt::print("config {:<4} {:>5} experts  {}\n", c, specs[c].size(),
+                   opts.configs[c]);
+    }
+
+    // Loss and regret are per round, the win rate per game.
+    fmt::print("\n{:<7} {:<24} {:>7} {:>8} {:>8} {:>8}\n", "config",
+               "opponent", "games", "loss", "win rate", "regret");
+    std::vector<double> mean_loss(specs.size());
+    for (size_t c = 0; c < specs.size(); c++) {
+        SweepStats all;
+        for (size_t o = 0; o < opponents.size(); o++) {
+            const auto &s = total[c * opponents.size() + o];
+            double rounds = std::max(1.0, (double)s.rounds);
+            double n = std::max(1.0, (double)s.games);
+            fmt::print("{:<7} {:<24} {:>7} {:>8.4f} {:>8.4f} {:>8.4f}\n", c,
+                       opponents[o].name, s.games, s.losses / rounds,
+                       s.cpu_wins / n, s.regret / rounds);
+            mean_loss[c] += s.losses / rounds / opponents.size();
+            all.add(s);
+        }
+        double rounds = std::max(1.0, (double)all.rounds);
+        double n = std::max(1.0, (double)all.games);
+        fmt::print("{:<7} {:<24} {:>7} {:>8.4f} {:>8.4f} {:>8.4f}\n", c,
+                   "all", all.games, all.losses / rounds, all.cpu_wins / n,
+                   all.regret / rounds);
+    }
+
+    // Pools by their loss averaged over opponents, best first.
+    std::vector<size_t> order(specs.size());
+    for (size_t c = 0; c < order.size(); c++) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return mean_loss[a] < mean_loss[b];
+    });
+    fmt::print("\n{:<7} {:>10}\n", "config", "mean loss");
+    for (auto c : order) {
+        fmt::print("{:<7} {:>10.4f}\n", c, mean_loss[c]);
+    }
+
+    return 0;
+}
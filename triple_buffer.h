@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+
+// The latest value of something one thread computes and another displays,
+// handed over without locks. The writer fills back() and publish()es it
+// with one atomic exchange; the reader's latest() takes the newest
+// published buffer with another. Neither ever waits for the other, the
+// reader always sees a whole value, and buffers are reused, so a writer
+// that refills its vectors in place stops allocating.
+template <typename T> struct TripleBuffer {
+    T &back() { return m_buffers[m_back]; }
+
+    void publish() {
+        m_back = m_middle.exchange(m_back | fresh,
+                                   std::memory_order_acq_rel) &
+                 ~fresh;
+    }
+
+    // The newest published value, which stays valid and unchanged until
+    // the next call. Only the reader thread may call it.
+    const T &latest() {
+        if (m_middle.load(std::memory_order_relaxed) & fresh)
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) &
+                      ~fresh;
+        return m_buffers[m_front];
+    }
+
+  private:
+    static constexpr int fresh = 4;
+
+    T m_buffers[3];
+    int m_back = 0;  // the writer's
+    int m_front = 1; // the reader's
+    std::atomic<int> m_middle{2};
+};
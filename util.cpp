@@ -1,44 +1,21 @@
-#include <GLFW/glfw3.h>
-#include <stdio.h>
-#include <random>
 #include <vector>
 #include <numeric>
+#include "rng.h"
 #include "util.h"
+#include "weights.h"
 
-void glfw_error_callback(int error, const char *description) {
-    fprintf(stderr, "Glfw Error %d: %s\n", error, description);
+static RandomStream &thread_stream() {
+    // One stream per thread so that headless games can run in parallel.
+    thread_local RandomStream stream(random_seed());
+    return stream;
 }
 
-int InitializeOnce() {
-    glfwSetErrorCallback(glfw_error_callback);
-    int success = glfwInit();
+double runif() { return thread_stream()(); }
 
-    if (!success)
-        return success;
+void runif(double *u, size_t n) { thread_stream().fill(u, n); }
 
-#if __APPLE__
-    // GL 3.2 + GLSL 150
-    const char *glsl_version = "#version 150";
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // 3.2+ only
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // Required on Mac
-#else
-    // GL 3.0 + GLSL 130
-    const char *glsl_version = "#version 130";
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // 3.0+ only
-#endif
-
-    return 0;
-}
-
-double runif() {
-    static std::random_device rd;
-    static std::mt19937 twister(rd());
-    static std::uniform_real_distribution<> dist(0, 1);
-    return dist(twister);
+void seed_runif(uint64_t seed, uint64_t stream) {
+    thread_stream() = RandomStream(seed, stream);
 }
 
 unsigned int sample(const std::vector<double>& v) {
@@ -56,14 +33,7 @@ unsigned int sample(const std::vector<double>& v) {
 }
 
 unsigned int softmax_sample(const std::vector<double>& v, double eta) {
-    double M = v[0];
-    for (unsigned i = 0; i < v.size(); ++i) {
-        M = M >= v[i] ? M : v[i];
-    }
-
-    auto w = v;
-    for (unsigned i = 0; i < v.size(); ++i) {
-        w[i] = std::exp((w[i] - M) * eta);
-    }
-    return sample(w); 
-}
\ No newline at end of file
+    std::vector<double> w(v.size());
+    softmax_weights(v.data(), v.size(), eta, w.data());
+    return sample(w);
+}
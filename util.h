@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
-int InitializeOnce();
-void glfw_error_callback(int error, const char *description);
-
+// Uniforms in [0, 1) from the calling thread's RandomStream (rng.h). Each
+// thread starts from a random seed; seed_runif() makes it replayable.
 double runif();
+void runif(double *u, size_t n);
+void seed_runif(uint64_t seed, uint64_t stream = 0);
+
 unsigned int sample(const std::vector<double>& v);
-unsigned int softmax_sample(const std::vector<double>& v, double eta);
\ No newline at end of file
+unsigned int softmax_sample(const std::vector<double>& v, double eta);
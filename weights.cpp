@@ -0,0 +1,225 @@
+#include "weights.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MINDREADER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using MaxKernel = double (*)(const double *, size_t);
+using ExpKernel = double (*)(const double *, size_t, double, double,
+                             double *);
+
+double max_scalar(const double *s, size_t n) {
+    double M = s[0];
+    for (size_t i = 0; i < n; i++) {
+        M = M >= s[i] ? M : s[i];
+    }
+    return M;
+}
+
+double weights_scalar(const double *s, size_t n, double eta, double M,
+                      double *w) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        w[i] = std::exp((s[i] - M) * eta);
+        sum += w[i];
+    }
+    return sum;
+}
+
+#ifdef MINDREADER_X86
+
+// exp(x) for x <= 0: x = k ln2 + r with |r| <= ln2 / 2, exp(r) from its
+// Taylor series to degree 12 (relative error below 2e-16), and 2^k from
+// the exponent bits. Results below the double range flush to zero.
+const double LOG2E = 1.4426950408889634;
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+const double EXP_MIN = -708.0;
+const double COEFFS[] = {1.0 / 479001600, 1.0 / 39916800, 1.0 / 3628800,
+                         1.0 / 362880,    1.0 / 40320,    1.0 / 5040,
+                         1.0 / 720,       1.0 / 120,      1.0 / 24,
+                         1.0 / 6,         0.5,            1.0,
+                         1.0};
+
+__attribute__((target("avx2,fma"))) inline __m256d exp_avx2(__m256d x) {
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(LOG2E)),
+                                _MM_FROUND_TO_NEAREST_INT |
+                                    _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_HI), x);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_LO), r);
+
+    __m256d p = _mm256_set1_pd(COEFFS[0]);
+    for (int j = 1; j < 13; j++) {
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(COEFFS[j]));
+    }
+
+    // 2^k: add the rounding constant 1.5 * 2^52 so the low bits hold k.
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+    __m256i bits = _mm256_castpd_si256(_mm256_add_pd(k, magic));
+    bits = _mm256_sub_epi64(bits, _mm256_castpd_si256(magic));
+    bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)),
+                             52);
+    __m256d y = _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+
+    __m256d in_range =
+        _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MIN), _CMP_GE_OQ);
+    return _mm256_and_pd(y, in_range);
+}
+
+__attribute__((target("avx2,fma"))) double max_avx2(const double *s,
+                                                   size_t n) {
+    size_t i = 0;
+    __m256d vmax = _mm256_set1_pd(s[0]);
+    for (; i + 4 <= n; i += 4) {
+        vmax = _mm256_max_pd(vmax, _mm256_loadu_pd(s + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vmax);
+    double M = std::max(std::max(lanes[0], lanes[1]),
+                        std::max(lanes[2], lanes[3]));
+    for (; i < n; i++) {
+        M = M >= s[i] ? M : s[i];
+    }
+    return M;
+}
+
+__attribute__((target("avx2,fma"))) double
+weights_avx2(const double *s, size_t n, double eta, double M, double *w) {
+    size_t i = 0;
+    double lanes[4];
+    __m256d vM = _mm256_set1_pd(M);
+    __m256d veta = _mm256_set1_pd(eta);
+    __m256d vsum = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(s + i), vM),
+                                  veta);
+        __m256d e = exp_avx2(x);
+        _mm256_storeu_pd(w + i, e);
+        vsum = _mm256_add_pd(vsum, e);
+    }
+    _mm256_storeu_pd(lanes, vsum);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++) {
+        w[i] = std::exp((s[i] - M) * eta);
+        sum += w[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f"))) inline __m512d exp_avx512(__m512d x) {
+    __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(LOG2E)),
+                                     _MM_FROUND_TO_NEAREST_INT |
+                                         _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_HI), x);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_LO), r);
+
+    __m512d p = _mm512_set1_pd(COEFFS[0]);
+    for (int j = 1; j < 13; j++) {
+        p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(COEFFS[j]));
+    }
+
+    __m512d y = _mm512_scalef_pd(p, k);
+    __mmask8 in_range =
+        _mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_MIN), _CMP_GE_OQ);
+    return _mm512_maskz_mov_pd(in_range, y);
+}
+
+__attribute__((target("avx512f"))) double max_avx512(const double *s,
+                                                   size_t n) {
+    size_t i = 0;
+    __m512d vmax = _mm512_set1_pd(s[0]);
+    for (; i + 8 <= n; i += 8) {
+        vmax = _mm512_max_pd(vmax, _mm512_loadu_pd(s + i));
+    }
+    double M = _mm512_reduce_max_pd(vmax);
+    for (; i < n; i++) {
+        M = M >= s[i] ? M : s[i];
+    }
+    return M;
+}
+
+__attribute__((target("avx512f"))) double
+weights_avx512(const double *s, size_t n, double eta, double M, double *w) {
+    size_t i = 0;
+    __m512d vM = _mm512_set1_pd(M);
+    __m512d veta = _mm512_set1_pd(eta);
+    __m512d vsum = _mm512_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m512d x = _mm512_mul_pd(_mm512_sub_pd(_mm512_loadu_pd(s + i), vM),
+                                  veta);
+        __m512d e = exp_avx512(x);
+        _mm512_storeu_pd(w + i, e);
+        vsum = _mm512_add_pd(vsum, e);
+    }
+    double sum = _mm512_reduce_add_pd(vsum);
+    for (; i < n; i++) {
+        w[i] = std::exp((s[i] - M) * eta);
+        sum += w[i];
+    }
+    return sum;
+}
+
+#endif
+
+struct Dispatch {
+    MaxKernel max;
+    ExpKernel exp;
+    const char *name;
+
+    Dispatch() : max{max_scalar}, exp{weights_scalar}, name{"scalar"} {
+#ifdef MINDREADER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            max = max_avx512;
+            exp = weights_avx512;
+            name = "avx512";
+        } else if (__builtin_cpu_supports("avx2") &&
+                   __builtin_cpu_supports("fma")) {
+            max = max_avx2;
+            exp = weights_avx2;
+            name = "avx2";
+        }
+#endif
+    }
+};
+
+const Dispatch &dispatch() {
+    static const Dispatch d;
+    return d;
+}
+
+} // namespace
+
+double softmax_weights(const double *scores, size_t n, double eta,
+                       double *w, double *max) {
+    if (n == 0)
+        return 0.0;
+    double M = dispatch().max(scores, n);
+    if (max)
+        *max = M;
+    return dispatch().exp(scores, n, eta, M, w);
+}
+
+void softmax_percent(const double *scores, size_t n, double eta, double *w) {
+    double sum = softmax_weights(scores, n, eta, w);
+    double c = 100.0 / sum;
+    for (size_t i = 0; i < n; i++) {
+        w[i] *= c;
+    }
+}
+
+double max_score(const double *scores, size_t n) {
+    return n == 0 ? 0.0 : dispatch().max(scores, n);
+}
+
+double exp_weights(const double *scores, size_t n, double eta, double offset,
+                   double *w) {
+    return n == 0 ? 0.0 : dispatch().exp(scores, n, eta, offset, w);
+}
+
+const char *weights_kernel_name() { return dispatch().name; }
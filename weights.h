@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Exponential weights kernel shared by prediction and statistics.
+//
+// softmax_weights() sets w[i] = exp(eta * (scores[i] - max(scores))) and
+// returns the sum of w, in two passes over the data; if max is given it
+// receives max(scores). softmax_percent() does the same and then rescales w
+// to percentages. w may alias scores.
+//
+// The two passes are also available on their own, for callers that split
+// the scores: max_score() and exp_weights(), which sets w[i] =
+// exp(eta * (scores[i] - offset)) and returns the sum. Each w[i] is the
+// same as softmax_weights() gives when the pieces start at multiples of 8.
+//
+// The kernel is picked at run time: AVX-512, AVX2 + FMA or portable scalar
+// code, whichever the CPU supports.
+double softmax_weights(const double *scores, size_t n, double eta,
+                       double *w, double *max = nullptr);
+void softmax_percent(const double *scores, size_t n, double eta, double *w);
+double max_score(const double *scores, size_t n);
+double exp_weights(const double *scores, size_t n, double eta, double offset,
+                   double *w);
+
+// Name of the kernel in use: "avx512", "avx2" or "scalar".
+const char *weights_kernel_name();
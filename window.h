@@ -0,0 +1,4 @@
+#pragma once
+
+int InitializeOnce();
+void glfw_error_callback(int error, const char *description);